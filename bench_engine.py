@@ -0,0 +1,220 @@
+"""
+Engine benchmark for SubtitlesForAll
+
+Times the Moonshine encoder and decoder stages on short windows under each
+thread spin policy (see moonshine_engine.py). Between windows it idles for
+``--gap`` seconds, as a live stream does. Pool threads have parked by the
+time the next window arrives, so wake-up latency shows up in the numbers.
+
+Usage:
+    python bench_engine.py --model moonshine/tiny
+    python bench_engine.py --audio speech.wav --windows 1 1.5 2 --threads 4
+    python bench_engine.py --json results.json
+    python bench_engine.py --specialize   # also time specialised sessions
+
+Reports p50/p95 wall time per stage and the CPU time spent per window (what
+spinning costs). The policies are compared on per-session pools, so only
+the spin policy differs; "hybrid+global" then runs hybrid on ONNX Runtime's
+process-wide pool, which is what the server uses when the stages share
+their threads. That run comes last: once the process-wide pool exists,
+every later session has to use it.
+
+Then it measures throughput on a stream of ``--stream`` windows fed back to
+back: once with the stages run in turn on every thread, once through
+StagePipeline with the threads split between the stages (--encoder-threads,
+default half), so the next window encodes while the previous one decodes.
+"""
+
+import argparse
+import asyncio
+import json
+import sys
+import time
+import wave
+
+import numpy as np
+
+from concurrent.futures import ThreadPoolExecutor
+
+from moonshine_engine import SPIN_POLICIES, StagePipeline
+
+SAMPLE_RATE = 16000
+
+
+def load_audio(path: str, seconds: float) -> np.ndarray:
+    """16 kHz mono audio from a WAV file, or low-level noise if no file is given."""
+    if not path:
+        return (np.random.default_rng(0).standard_normal(int(SAMPLE_RATE * seconds)) * 0.01).astype(np.float32)
+    with wave.open(path, "rb") as wav:
+        if wav.getframerate() != SAMPLE_RATE or wav.getnchannels() != 1 or wav.getsampwidth() != 2:
+            sys.exit(f"{path}: expected 16 kHz mono 16-bit WAV")
+        audio = np.frombuffer(wav.readframes(wav.getnframes()), dtype=np.int16).astype(np.float32) / 32768.0
+    if len(audio) < SAMPLE_RATE * seconds:
+        audio = np.tile(audio, int(SAMPLE_RATE * seconds // max(len(audio), 1)) + 1)
+    return audio
+
+
+def percentile(values, q) -> float:
+    return float(np.percentile(values, q)) if values else 0.0
+
+
+def bench_policy(transcriber, audio: np.ndarray, windows, repeat: int, gap: float) -> list:
+    rows = []
+    for seconds in windows:
+        samples = int(SAMPLE_RATE * seconds)
+        encode_ms, decode_ms, cpu_ms = [], [], []
+        for i in range(repeat):
+            offset = (i * samples) % max(len(audio) - samples, 1)
+            window = audio[offset:offset + samples]
+            time.sleep(gap)
+            cpu = time.process_time()
+            started = time.perf_counter()
+            stage = transcriber.encode(window)
+            encoded = time.perf_counter()
+            transcriber.decode(stage)
+            finished = time.perf_counter()
+            encode_ms.append((encoded - started) * 1000)
+            decode_ms.append((finished - encoded) * 1000)
+            cpu_ms.append((time.process_time() - cpu) * 1000)
+        rows.append({
+            "window_s": seconds,
+            "encode_p50": percentile(encode_ms, 50), "encode_p95": percentile(encode_ms, 95),
+            "decode_p50": percentile(decode_ms, 50), "decode_p95": percentile(decode_ms, 95),
+            "total_p50": percentile([e + d for e, d in zip(encode_ms, decode_ms)], 50),
+            "cpu_ms": float(np.mean(cpu_ms)),
+        })
+    return rows
+
+
+def bench_stream(sequential, pipelined, audio: np.ndarray, seconds: float, count: int) -> dict:
+    """Windows per second through both transcribers, stages in turn vs overlapped."""
+    samples = int(SAMPLE_RATE * seconds)
+    windows = [audio[(i * samples) % max(len(audio) - samples, 1):][:samples] for i in range(count)]
+
+    sequential.transcribe(windows[0])
+    started = time.perf_counter()
+    for window in windows:
+        sequential.transcribe(window)
+    sequential_s = time.perf_counter() - started
+
+    async def overlapped():
+        with ThreadPoolExecutor(1) as encoder_pool, ThreadPoolExecutor(1) as decoder_pool:
+            pipeline = StagePipeline(pipelined, encoder_pool, decoder_pool)
+
+            async def feed():
+                for window in windows:
+                    await pipeline.submit(window, None)
+
+            feeder = asyncio.create_task(feed())
+            results = pipeline.results()
+            for _ in windows:
+                await results.__anext__()
+            await feeder
+            return pipeline.stats["overlapped"]
+
+    pipelined.transcribe(windows[0])
+    started = time.perf_counter()
+    overlapped_windows = asyncio.run(overlapped())
+    pipelined_s = time.perf_counter() - started
+    return {
+        "window_s": seconds,
+        "windows": count,
+        "sequential_per_s": count / sequential_s,
+        "pipelined_per_s": count / pipelined_s,
+        "overlapped": overlapped_windows,
+        "speedup": sequential_s / pipelined_s,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Moonshine engine benchmark")
+    parser.add_argument("--model", default="moonshine/tiny", help="Moonshine model to load")
+    parser.add_argument("--audio", default=None, help="16 kHz mono WAV to slice windows from")
+    parser.add_argument("--windows", type=float, nargs="+", default=[1.0, 1.5, 2.0],
+                        help="Window lengths in seconds")
+    parser.add_argument("--repeat", type=int, default=20, help="Windows timed per length")
+    parser.add_argument("--gap", type=float, default=0.5, help="Idle seconds between windows")
+    parser.add_argument("--threads", type=int, default=0, help="Intra-op threads (0 = one per CPU)")
+    parser.add_argument("--encoder-threads", type=int, default=None,
+                        help="The encoder's share of --threads in the pipelined run (default: half)")
+    parser.add_argument("--stream", type=int, default=30,
+                        help="Windows in the throughput stream (0 = skip it)")
+    parser.add_argument("--policies", nargs="+", default=list(SPIN_POLICIES), choices=SPIN_POLICIES)
+    parser.add_argument("--specialize", action="store_true",
+                        help="Also time sessions specialised for one window per call")
+    parser.add_argument("--json", default=None, help="Also write the results to this file")
+    args = parser.parse_args()
+
+    import moonshine_server
+    if not moonshine_server.MOONSHINE_AVAILABLE:
+        sys.exit("Moonshine ONNX is not installed: pip install useful-moonshine-onnx")
+
+    audio = load_audio(args.audio, max(args.windows) * args.repeat)
+    results = {}
+    # label -> (spin policy, specialised, process-wide pool)
+    runs = {policy: (policy, False, False) for policy in args.policies}
+    if args.specialize:
+        runs.update({f"{policy}+spec": (policy, True, False) for policy in args.policies})
+    if "hybrid" in args.policies:
+        runs["hybrid+global"] = ("hybrid", False, True)
+    # Sessions with pools of their own load before the process-wide pool exists
+    pipelined = None
+    if args.stream:
+        pipelined = moonshine_server.MoonshineTranscriber(args.model, args.threads, args.policies[0],
+                                                          encoder_threads=args.encoder_threads)
+    transcribers = {}
+    for label, (policy, specialized, shared) in runs.items():
+        transcriber = moonshine_server.MoonshineTranscriber(args.model, args.threads, policy, specialized,
+                                                            shared_pool=shared)
+        if transcriber.model is None:
+            sys.exit(f"Could not load {args.model}")
+        transcribers[label] = transcriber
+    for label, transcriber in transcribers.items():
+        results[label] = bench_policy(transcriber, audio, args.windows, args.repeat, args.gap)
+
+    print(f"\n{args.model}, {args.threads or 'auto'} threads, {args.repeat} windows each, {args.gap}s gap")
+    print(f"{'policy':13} {'window':>6} {'enc p50':>8} {'enc p95':>8} {'dec p50':>8} {'dec p95':>8} "
+          f"{'total':>8} {'cpu':>8}")
+    for policy, rows in results.items():
+        for row in rows:
+            print(f"{policy:13} {row['window_s']:>5}s {row['encode_p50']:>6.1f}ms {row['encode_p95']:>6.1f}ms "
+                  f"{row['decode_p50']:>6.1f}ms {row['decode_p95']:>6.1f}ms {row['total_p50']:>6.1f}ms "
+                  f"{row['cpu_ms']:>6.1f}ms")
+
+    def compare(title, ours, theirs):
+        print(f"\n{title}, median total latency:")
+        for row, base in zip(results[ours], results[theirs]):
+            change = (row["total_p50"] - base["total_p50"]) / max(base["total_p50"], 1e-9) * 100
+            print(f"  {row['window_s']}s window: {change:+.1f}%")
+
+    if "hybrid" in results and "park" in results:
+        compare("Spin-then-park vs park (per-session pools)", "hybrid", "park")
+    if "hybrid+global" in results:
+        compare("Process-wide vs per-session pool (hybrid)", "hybrid+global", "hybrid")
+
+    if args.specialize:
+        print("\nSpecialised vs generic sessions, median total latency:")
+        for policy in args.policies:
+            for generic, spec in zip(results[policy], results[f"{policy}+spec"]):
+                change = (spec["total_p50"] - generic["total_p50"]) / max(generic["total_p50"], 1e-9) * 100
+                print(f"  {policy}, {generic['window_s']}s window: {change:+.1f}%")
+
+    stream = None
+    if args.stream:
+        policy = args.policies[0]
+        sequential = transcribers[policy]
+        stream = bench_stream(sequential, pipelined, audio, max(args.windows), args.stream)
+        print(f"\nThroughput, {stream['windows']} x {stream['window_s']}s windows back to back ({policy}):")
+        print(f"  stages in turn, {sequential.layout.describe()}: {stream['sequential_per_s']:.1f} windows/s")
+        print(f"  pipelined, {pipelined.layout.describe()}: {stream['pipelined_per_s']:.1f} windows/s "
+              f"({stream['overlapped']} encoded during a decode)")
+        print(f"  pipelined vs in turn: {(stream['speedup'] - 1) * 100:+.1f}%")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"model": args.model, "threads": args.threads, "gap": args.gap,
+                       "results": results, "stream": stream}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,163 @@
+"""
+Micro-benchmarks for the servers' audio and text hot paths
+
+Times the small pieces every window or frame goes through, in isolation,
+so a regression in one of them shows up before it is lost in end-to-end
+noise. The JavaScript side (capture worklet, overlay, datagram sender,
+detokenizer) has the same harness in electron/bench-hotpaths.mjs.
+
+Usage:
+    python bench_hotpaths.py                          # print timings
+    python bench_hotpaths.py --save baseline.json     # record a baseline
+    python bench_hotpaths.py --compare baseline.json  # exit 1 on a regression
+    python bench_hotpaths.py --filter wav --repeats 15
+
+Each case is calibrated to run about --min-time seconds per repeat. The
+median time per call over --repeats repeats is reported, with the spread
+(median absolute deviation) as a percentage. A case counts as a regression
+when it is slower than the baseline by more than --threshold and by more
+than three times its spread. Baselines only make sense on the machine that
+recorded them.
+"""
+
+import argparse
+import asyncio
+import json
+import sys
+import time
+
+import numpy as np
+
+SAMPLE_RATE = 16000
+FRAME_SAMPLES = 1365  # the capture worklet's frame (~85 ms)
+
+
+def measure(fn, repeats: int, min_time: float) -> dict:
+    """Median and spread of one call's time in nanoseconds."""
+    number = 1
+    while True:
+        started = time.perf_counter()
+        for _ in range(number):
+            fn()
+        elapsed = time.perf_counter() - started
+        if elapsed >= min_time / 4:
+            break
+        number *= 4
+    number = max(1, int(number * min_time / elapsed))
+    samples = []
+    for _ in range(repeats):
+        started = time.perf_counter_ns()
+        for _ in range(number):
+            fn()
+        samples.append((time.perf_counter_ns() - started) / number)
+    median = float(np.median(samples))
+    spread = float(np.median(np.abs(np.array(samples) - median))) / median if median else 0.0
+    return {"ns": round(median, 1), "spread": round(spread, 4), "calls": number}
+
+
+def format_ns(ns: float) -> str:
+    if ns >= 1e6:
+        return f"{ns / 1e6:.2f} ms"
+    if ns >= 1e3:
+        return f"{ns / 1e3:.2f} µs"
+    return f"{ns:.0f} ns"
+
+
+def cases() -> dict:
+    """name -> zero-argument callable, each one step of a real code path."""
+    from detokenizer import Detokenizer
+    from datagram_transport import DatagramSender
+    from flow_control import AudioInbox
+    from run_server import pcm16, pcm16_wav
+
+    rng = np.random.default_rng(0)
+    window = (rng.standard_normal(SAMPLE_RATE * 2) * 0.1).astype(np.float32)
+    frames = [window[i:i + FRAME_SAMPLES] for i in range(0, len(window) - FRAME_SAMPLES, FRAME_SAMPLES)]
+    carried = window[:SAMPLE_RATE]
+    segment = {"segments": [{"id": 42, "rev": 0, "text": "and that is why the meeting moved to Thursday",
+                             "start": 12.345, "end": 14.345}]}
+    inbox = AudioInbox()
+    sender = DatagramSender(lambda packet: None, "00" * 8)
+    tenth = window[:SAMPLE_RATE // 10]
+
+    vocab = {"<s>": 1, "</s>": 2, "<0xE4>": 3, "<0xB8>": 4, "<0xAD>": 5}
+    words = "and that is why the meeting moved to thursday".split()
+    vocab.update({f"▁{w}": 10 + i for i, w in enumerate(words)})
+    detokenizer = Detokenizer({"model": {"vocab": vocab},
+                               "added_tokens": [{"id": 1, "content": "<s>", "special": True},
+                                                {"id": 2, "content": "</s>", "special": True}]})
+    tokens = [10 + i for i in range(len(words))] + [3, 4, 5, 2]
+
+    def inbox_round_trip():
+        for frame in frames:
+            inbox.put(frame)
+        inbox.take_all()
+
+    def detokenize_stream():
+        stream = detokenizer.stream()
+        for token in tokens:
+            stream.push(token)
+        stream.finish()
+
+    return {
+        # run_server.py: the 2 s window whisper-server receives
+        "float_to_int16_2s": lambda: pcm16(window),
+        "wav_pack_2s": lambda: pcm16_wav(window),
+        # run_server.py handle_client: frames joined into one window
+        "concat_frames_2s": lambda: np.concatenate(frames),
+        # moonshine_server.py handle_client: new frames appended to the carried audio
+        "concat_append_1s": lambda: np.concatenate([carried, *frames[:3]]),
+        "json_segment": lambda: json.dumps(segment),
+        "credit_message": inbox.credit_message,
+        "inbox_put_take_2s": inbox_round_trip,
+        # datagram_transport.py: 100 ms of audio to PCM packets with parity
+        "datagram_pack_100ms": lambda: sender.push(tenth),
+        "detokenize_stream_13": detokenize_stream,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Micro-benchmarks for the servers' hot paths")
+    parser.add_argument("--filter", default="", help="Only run cases whose name contains this")
+    parser.add_argument("--repeats", type=int, default=9)
+    parser.add_argument("--min-time", type=float, default=0.05, help="Seconds per repeat")
+    parser.add_argument("--save", default=None, help="Write the results as a baseline")
+    parser.add_argument("--compare", default=None, help="Baseline to compare against")
+    parser.add_argument("--threshold", type=float, default=0.10, help="Slowdown that counts as a regression")
+    args = parser.parse_args()
+
+    # AudioInbox creates an asyncio.Queue, which wants a current loop on older Pythons
+    asyncio.set_event_loop(asyncio.new_event_loop())
+    baseline = {}
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)["results"]
+
+    results = {}
+    regressions = []
+    print(f"{'case':24} {'time':>12} {'spread':>7} {'baseline':>12} {'change':>8}")
+    for name, fn in cases().items():
+        if args.filter not in name:
+            continue
+        result = results[name] = measure(fn, args.repeats, args.min_time)
+        line = f"{name:24} {format_ns(result['ns']):>12} {result['spread']:>6.1%}"
+        if name in baseline:
+            before = baseline[name]["ns"]
+            change = (result["ns"] - before) / before
+            line += f" {format_ns(before):>12} {change:>+7.1%}"
+            if change > args.threshold and change > 3 * max(result["spread"], baseline[name]["spread"]):
+                regressions.append(name)
+                line += "  REGRESSION"
+        print(line)
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump({"python": sys.version.split()[0], "numpy": np.__version__, "results": results}, f, indent=2)
+        print(f"\nBaseline written to {args.save}")
+    if regressions:
+        print(f"\n{len(regressions)} regression(s): {', '.join(regressions)}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+"""
+Whisper model benchmark for SubtitlesForAll
+
+Loads each model into a running whisper-server in turn (its /load endpoint)
+and transcribes a folder of your own recordings in the server's 2 s windows.
+Use it to check whether a turbo or distil checkpoint gives large-model
+accuracy within the latency budget of your CPU before picking it in the app.
+
+Usage:
+    python bench_whisper.py --corpus recordings/
+    python bench_whisper.py --corpus recordings-de/ --language de \\
+        --models base-q5_1 medium large-v3-turbo-q5_0 --report bench-de.md
+
+The corpus is a directory of 16 kHz mono 16-bit WAV files, with an optional
+transcript next to each (speech.wav + speech.txt). Models are scored against
+the transcripts when there are any, and against the first model's output
+otherwise. Start whisper-server with any model; it keeps the last model
+benchmarked, so restart it afterwards.
+"""
+
+import argparse
+import asyncio
+import json
+import sys
+import time
+import urllib.request
+from pathlib import Path
+
+import numpy as np
+
+from quantize_moonshine import load_corpus
+from run_server import WHISPER_MODELS, WhisperTranscriber, is_multilingual
+from shadow_eval import normalise, word_errors
+
+SAMPLE_RATE = 16000
+WINDOW_SECONDS = 2.0  # run_server.py transcribes every 2 s of audio
+DEFAULT_MODELS = ["base-q5_1", "medium", "large-v3-turbo-q5_0", "large-v3-turbo", "distil-large-v3"]
+
+
+def windows(audio: np.ndarray) -> list:
+    size = int(SAMPLE_RATE * WINDOW_SECONDS)
+    return [audio[i:i + size] for i in range(0, len(audio) - size // 4, size)]
+
+
+def load_model(server_url: str, model_path: Path):
+    """POST /load: whisper-server swaps its model (multipart field "model")."""
+    boundary = "----SubtitlesForAllBench"
+    body = (f"--{boundary}\r\n"
+            f'Content-Disposition: form-data; name="model"\r\n\r\n'
+            f"{model_path}\r\n--{boundary}--\r\n").encode()
+    request = urllib.request.Request(f"{server_url}/load", data=body,
+                                     headers={"Content-Type": f"multipart/form-data; boundary={boundary}"})
+    with urllib.request.urlopen(request, timeout=300) as response:
+        response.read()
+
+
+async def run_model(transcriber: WhisperTranscriber, items: list, language: str) -> dict:
+    """Transcribe every corpus window; texts per file and per-window latencies."""
+    texts, latencies, audio_seconds = {}, [], 0.0
+    for name, audio, _ in items:
+        parts = []
+        for window in windows(audio):
+            started = time.perf_counter()
+            text, _ = await transcriber.transcribe_with_confidence(window, None, language)
+            latencies.append((time.perf_counter() - started) * 1000)
+            audio_seconds += len(window) / SAMPLE_RATE
+            parts.append(text.strip())
+        texts[name] = " ".join(parts)
+    return {"texts": texts, "latencies": latencies, "audio_s": audio_seconds}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark whisper models on your own recordings")
+    parser.add_argument("--corpus", required=True, help="Directory of 16 kHz mono WAV files (+ optional .txt)")
+    parser.add_argument("--models", nargs="*", default=DEFAULT_MODELS, help="Model names, as in the app")
+    parser.add_argument("--models-dir", default=str(Path(__file__).parent.parent / "models"))
+    parser.add_argument("--server-url", default="http://127.0.0.1:8080", help="whisper-server to benchmark on")
+    parser.add_argument("--language", default=None, help="Language code passed with every window, e.g. de")
+    parser.add_argument("--files", type=int, default=50, help="Use at most this many corpus files")
+    parser.add_argument("--report", default=None, help="Also write the report as Markdown")
+    parser.add_argument("--json", default=None, help="Also write the report as JSON")
+    args = parser.parse_args()
+
+    items = load_corpus(args.corpus, args.files)
+    models_dir = Path(args.models_dir)
+    models = []
+    for name in args.models:
+        path = models_dir / WHISPER_MODELS.get(name, (f"ggml-{name}.bin",))[0]
+        if not path.exists():
+            print(f"Skipping {name}: {path} not found")
+        elif args.language not in (None, "en") and not is_multilingual(name):
+            print(f"Skipping {name}: English only")
+        else:
+            models.append((name, path))
+    if not models:
+        sys.exit("No models to benchmark")
+
+    results = {}
+    for name, path in models:
+        print(f"Loading {name}...")
+        load_model(args.server_url, path)
+        transcriber = WhisperTranscriber(str(path), server_url=args.server_url)
+        transcriber.current_model_name = name
+        # One untimed window so the first measurement does not include warm-up
+        asyncio.run(transcriber.transcribe_with_confidence(windows(items[0][1])[0], None, args.language))
+        results[name] = asyncio.run(run_model(transcriber, items, args.language))
+        results[name]["path"] = path
+
+    rows = []
+    baseline = results[models[0][0]]["texts"]
+    for name, result in results.items():
+        errors = words = 0
+        for file_name, _, reference in items:
+            ref_words = normalise(reference if reference is not None else baseline[file_name])
+            errors += word_errors(ref_words, normalise(result["texts"][file_name]))
+            words += len(ref_words)
+        latencies = result["latencies"]
+        rows.append({
+            "model": name,
+            "size_mb": round(result["path"].stat().st_size / 1e6),
+            "decoder_layers": WHISPER_MODELS.get(name, (None, None))[1],
+            "p50_ms": round(float(np.percentile(latencies, 50))),
+            "p95_ms": round(float(np.percentile(latencies, 95))),
+            "rtf": round(sum(latencies) / 1000 / result["audio_s"], 3),
+            "wer": round(errors / max(words, 1), 4),
+        })
+
+    scored_against = "reference transcripts" if any(r for _, _, r in items) else f"{models[0][0]} output"
+    lines = [
+        "# Whisper model benchmark",
+        "",
+        f"{len(items)} files, {sum(len(windows(a)) for _, a, _ in items)} windows of {WINDOW_SECONDS:g} s, "
+        f"language {args.language or 'auto'}, WER against {scored_against}",
+        "",
+        "| Model | Size (MB) | Decoder layers | p50 (ms) | p95 (ms) | RTF | WER |",
+        "|---|---|---|---|---|---|---|",
+    ]
+    for row in rows:
+        lines.append(f"| {row['model']} | {row['size_mb']} | {row['decoder_layers'] or '-'} | {row['p50_ms']} | "
+                     f"{row['p95_ms']} | {row['rtf']} | {row['wer']:.1%} |")
+    text = "\n".join(lines)
+    print("\n" + text)
+    print("\nAn RTF below 0.5 leaves headroom for live captions; above 1 the overlay falls behind.")
+    if args.report:
+        Path(args.report).write_text(text + "\n")
+    if args.json:
+        Path(args.json).write_text(json.dumps({"language": args.language, "rows": rows}, indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,182 @@
+"""
+Caption fan-out for SubtitlesForAll
+
+One capturing session can publish its segment stream under a channel name and
+any number of read-only viewers can follow it, without transcribing again.
+
+Publishing (capture client, on its normal WebSocket):
+
+    client -> server  {"publish": "stage-left", ...config...}
+    server -> client  {"type": "publishing", "channel": "stage-left",
+                       "subscribe_path": "/subscribe/stage-left"}
+
+A channel has one publisher at a time: segment ids are per session, so two
+streams in one channel would overwrite each other's captions. A second
+publisher gets {"type": "publish_rejected", "channel": ..., "reason": ...}
+and keeps transcribing unpublished.
+
+Subscribing (viewer, read-only):
+
+    ws://<server>/subscribe/stage-left
+
+Segment diff protocol sent to viewers:
+
+    {"type": "snapshot", "channel": ..., "segments": [segment, ...]}
+    {"type": "segment", "channel": ..., "id": 7, "rev": 0, "text": ...,
+     "start": 12.5, "end": 14.5}
+    {"type": "end", "channel": ...}
+
+A segment with an already-seen ``id`` and a higher ``rev`` replaces the
+earlier text. Times are seconds since the publisher's session started.
+
+Every event is serialised once and the same UTF-8 buffer is written to all
+viewers. Viewers that stop reading are disconnected instead of buffering
+without bound.
+
+Browser sources (OBS etc.) load the overlay page from the same port:
+
+    http://<server>/overlay/stage-left?fontSize=48&position=bottom
+
+The page is public/overlay.html, held in memory, and it follows the channel
+over /subscribe/ like any other viewer.
+"""
+
+import json
+import re
+from collections import OrderedDict
+from http import HTTPStatus
+from pathlib import Path
+
+import websockets
+from websockets.datastructures import Headers
+from websockets.http11 import Response
+
+SUBSCRIBE_PREFIX = "/subscribe/"
+OVERLAY_PREFIX = "/overlay/"
+OVERLAY_PAGE = Path(__file__).parent / "public" / "overlay.html"
+CHANNEL_NAME = re.compile(r"^[A-Za-z0-9_-]{1,64}$")
+DEFAULT_HISTORY = 50
+MAX_SUBSCRIBER_BUFFER = 256 * 1024
+
+
+class CaptionChannel:
+    """Recent segments of one published stream and the viewers following it."""
+
+    def __init__(self, name: str, history: int = DEFAULT_HISTORY):
+        self.name = name
+        self.history = history
+        self.segments = OrderedDict()
+        self.subscribers = set()
+        self.publishers = 0
+        self.events = 0
+
+    def publish(self, segment: dict):
+        # Revisions replace their segment in place, keeping snapshot order
+        self.segments[segment["id"]] = segment
+        while len(self.segments) > self.history:
+            self.segments.popitem(last=False)
+        self.fanout({"type": "segment", "channel": self.name, **segment})
+
+    def snapshot(self) -> bytes:
+        return json.dumps({
+            "type": "snapshot",
+            "channel": self.name,
+            "segments": list(self.segments.values()),
+        }).encode()
+
+    def fanout(self, event: dict):
+        """Serialise an event once and write the same buffer to every viewer."""
+        self.events += 1
+        for subscriber in list(self.subscribers):
+            transport = getattr(subscriber, "transport", None)
+            if transport is not None and transport.get_write_buffer_size() > MAX_SUBSCRIBER_BUFFER:
+                self.subscribers.discard(subscriber)
+                transport.abort()
+        if self.subscribers:
+            websockets.broadcast(self.subscribers, json.dumps(event).encode(), text=True)
+
+
+class CaptionHub:
+    """Registry of published caption channels for one server process."""
+
+    def __init__(self):
+        self.channels = {}
+        try:
+            self.overlay_page = OVERLAY_PAGE.read_bytes()
+        except OSError:
+            self.overlay_page = None
+
+    @staticmethod
+    def channel_from_path(path: str, prefix: str = SUBSCRIBE_PREFIX):
+        """Return the channel name for a <prefix><name> request path, else None."""
+        if not path.startswith(prefix):
+            return None
+        name = path[len(prefix):].split("?", 1)[0]
+        return name if CHANNEL_NAME.match(name) else None
+
+    def process_request(self, connection, request):
+        """websockets hook: answer plain GET /overlay/<channel> with the overlay page."""
+        if not request.path.startswith(OVERLAY_PREFIX):
+            return None
+        if self.overlay_page is None or self.channel_from_path(request.path, OVERLAY_PREFIX) is None:
+            return connection.respond(HTTPStatus.NOT_FOUND, "Not found\n")
+        headers = Headers([
+            ("Content-Type", "text/html; charset=utf-8"),
+            ("Content-Length", str(len(self.overlay_page))),
+            ("Cache-Control", "no-cache"),
+        ])
+        return Response(HTTPStatus.OK.value, HTTPStatus.OK.phrase, headers, self.overlay_page)
+
+    def _channel(self, name: str) -> CaptionChannel:
+        channel = self.channels.get(name)
+        if channel is None:
+            channel = self.channels[name] = CaptionChannel(name)
+        return channel
+
+    def start_publishing(self, name: str):
+        """Register a publisher; returns the reply message or None for a bad name."""
+        if not CHANNEL_NAME.match(name or ""):
+            return None
+        channel = self._channel(name)
+        if channel.publishers:
+            print(f"Channel '{name}' already has a publisher")
+            return {"type": "publish_rejected", "channel": name, "reason": "channel already has a publisher"}
+        channel.publishers = 1
+        print(f"Publishing captions on channel '{name}'")
+        return {
+            "type": "publishing",
+            "channel": name,
+            "subscribe_path": SUBSCRIBE_PREFIX + name,
+        }
+
+    def stop_publishing(self, name: str):
+        channel = self.channels.get(name)
+        if channel is None:
+            return
+        channel.publishers -= 1
+        if channel.publishers <= 0:
+            channel.fanout({"type": "end", "channel": name})
+            if not channel.subscribers:
+                del self.channels[name]
+
+    def publish(self, name: str, segment: dict):
+        channel = self.channels.get(name)
+        if channel is not None:
+            channel.publish(segment)
+
+    async def subscribe(self, websocket, name: str):
+        """Serve a read-only viewer until it disconnects."""
+        channel = self._channel(name)
+        await websocket.send(channel.snapshot(), text=True)
+        channel.subscribers.add(websocket)
+        print(f"Viewer joined '{name}'. Viewers: {len(channel.subscribers)}")
+        try:
+            # Viewers are read-only; anything they send is ignored
+            async for _ in websocket:
+                pass
+        except websockets.exceptions.ConnectionClosed:
+            pass
+        finally:
+            channel.subscribers.discard(websocket)
+            if not channel.subscribers and channel.publishers <= 0:
+                self.channels.pop(name, None)
@@ -0,0 +1,269 @@
+"""
+Datagram audio transport for SubtitlesForAll
+
+An alternative to sending audio over the WebSocket for clients on lossy links.
+Audio travels as small, sequenced UDP datagrams protected by XOR parity
+(forward error correction); transcription results keep using the WebSocket,
+which remains the reliable stream and the default audio path.
+
+Negotiation happens on the WebSocket:
+
+    client -> server  {"transport": "datagram", ...config...}
+    server -> client  {"type": "transport", "transport": "datagram",
+                       "port": 9190, "token": "9f2c...", "frame_samples": 320,
+                       "fec_group": 4}
+
+Packet layout (little-endian):
+
+    token    8 bytes   session token from the transport message
+    seq      uint32    audio: frame sequence number, parity: group number
+    kind     uint8     0 = audio, 1 = parity
+    group    uint8     number of audio frames covered by one parity packet
+    samples  uint16    samples per frame
+    payload  int16 PCM, 16 kHz mono (parity: XOR of the group's payloads)
+
+A lost frame is rebuilt from its group's parity when the rest of the group
+arrived; otherwise it is replaced by silence once later frames show it is
+not coming, so a loss costs 20 ms of audio instead of stalling the stream.
+A frame more than RESYNC_GROUPS groups away from the stream position, ahead
+or behind, means the sender restarted (or the packet is bogus): the receiver
+follows the new numbering instead of concealing or discarding everything in
+between.
+
+Loopback self-test with simulated loss:
+
+    python datagram_transport.py --selftest --loss 0.05
+"""
+
+import asyncio
+import os
+import random
+import struct
+
+import numpy as np
+
+HEADER = struct.Struct("<8sIBBH")
+KIND_AUDIO = 0
+KIND_PARITY = 1
+FRAME_SAMPLES = 320  # 20 ms at 16 kHz
+DEFAULT_FEC_GROUP = 4
+RESYNC_GROUPS = 16  # ~1.3 s at the default group size
+
+
+def xor_payloads(payloads) -> bytes:
+    """XOR equally sized payloads together."""
+    acc = np.zeros(len(payloads[0]), dtype=np.uint8)
+    for payload in payloads:
+        acc ^= np.frombuffer(payload, dtype=np.uint8)
+    return acc.tobytes()
+
+
+class DatagramReceiver:
+    """Reorders, repairs and conceals the datagrams of one session."""
+
+    def __init__(self, deliver, fec_group: int = DEFAULT_FEC_GROUP,
+                 frame_samples: int = FRAME_SAMPLES):
+        self.deliver = deliver
+        self.fec_group = fec_group
+        self.frame_bytes = frame_samples * 2
+        self.next_seq = 0
+        self.highest_seq = -1
+        self.frames = {}
+        self.parity = {}
+        self.released = {}
+        self.stats = {"received": 0, "recovered": 0, "concealed": 0, "late": 0, "resyncs": 0}
+
+    def on_packet(self, seq: int, kind: int, payload: bytes):
+        if len(payload) != self.frame_bytes:
+            return
+        first = seq * self.fec_group if kind == KIND_PARITY else seq
+        if abs(first - self.next_seq) > RESYNC_GROUPS * self.fec_group:
+            if kind == KIND_PARITY:
+                return
+            self._resync(seq)
+        if kind == KIND_PARITY:
+            if (seq + 1) * self.fec_group > self.next_seq:
+                self.parity[seq] = payload
+        elif seq < self.next_seq or seq in self.frames:
+            self.stats["late"] += 1
+            return
+        else:
+            self.stats["received"] += 1
+            self.frames[seq] = payload
+            self.highest_seq = max(self.highest_seq, seq)
+        self._release()
+
+    def _resync(self, seq: int):
+        """Restart at the group holding seq; nothing from before it is delivered."""
+        self.stats["resyncs"] += 1
+        self.next_seq = seq - seq % self.fec_group
+        self.highest_seq = -1
+        self.frames.clear()
+        self.parity.clear()
+        self.released.clear()
+
+    def _recover(self, seq: int):
+        group = seq // self.fec_group
+        parity = self.parity.get(group)
+        if parity is None:
+            return None
+        first = group * self.fec_group
+        others = [self.frames.get(s, self.released.get(s))
+                  for s in range(first, first + self.fec_group) if s != seq]
+        if any(p is None for p in others):
+            return None
+        self.stats["recovered"] += 1
+        return xor_payloads(others + [parity])
+
+    def _release(self):
+        # Wait for at most one FEC group past a gap before concealing it
+        horizon = self.fec_group + 1
+        while True:
+            payload = self.frames.pop(self.next_seq, None)
+            if payload is None:
+                payload = self._recover(self.next_seq)
+            if payload is not None:
+                self.released[self.next_seq] = payload
+            elif self.highest_seq - self.next_seq < horizon:
+                return
+            else:
+                self.stats["concealed"] += 1
+                payload = bytes(self.frame_bytes)
+            self.deliver(np.frombuffer(payload, dtype="<i2").astype(np.float32) / 32768.0)
+            self.next_seq += 1
+            if self.next_seq % self.fec_group == 0:
+                # Group complete: its parity and payloads are no longer needed
+                self.parity.pop(self.next_seq // self.fec_group - 1, None)
+                self.released.clear()
+
+
+class DatagramAudioServer(asyncio.DatagramProtocol):
+    """UDP endpoint feeding datagram audio into the sessions' AudioInbox."""
+
+    def __init__(self, loss: float = 0.0, fec_group: int = DEFAULT_FEC_GROUP):
+        self.loss = loss
+        self.fec_group = fec_group
+        self.port = None
+        self.sessions = {}
+
+    async def start(self, host: str, port: int):
+        loop = asyncio.get_running_loop()
+        transport, _ = await loop.create_datagram_endpoint(lambda: self, local_addr=(host, port))
+        self.port = transport.get_extra_info("sockname")[1]
+        print(f"Datagram audio transport on udp://{host}:{self.port}"
+              + (f" (simulating {self.loss:.0%} loss)" if self.loss else ""))
+
+    def register(self, inbox) -> dict:
+        """Bind a new token to a client's inbox and return the transport message."""
+        token = os.urandom(8)
+        # Datagram frames bypass the WebSocket credit window (flow_control.py)
+        self.sessions[token] = DatagramReceiver(lambda frame: inbox.put(frame, credited=False), self.fec_group)
+        return {
+            "type": "transport",
+            "transport": "datagram",
+            "port": self.port,
+            "token": token.hex(),
+            "frame_samples": FRAME_SAMPLES,
+            "fec_group": self.fec_group,
+        }
+
+    def unregister(self, token_hex: str) -> dict:
+        receiver = self.sessions.pop(bytes.fromhex(token_hex), None)
+        return receiver.stats if receiver else {}
+
+    def datagram_received(self, data, addr):
+        if len(data) < HEADER.size or (self.loss and random.random() < self.loss):
+            return
+        token, seq, kind, _group, _samples = HEADER.unpack_from(data)
+        receiver = self.sessions.get(token)
+        if receiver:
+            receiver.on_packet(seq, kind, data[HEADER.size:])
+
+
+class DatagramSender:
+    """Packetises 16 kHz float32 audio into sequenced datagrams with parity.
+
+    Mirrors electron/datagram-sender.cjs; used by the self-test.
+    """
+
+    def __init__(self, send, token_hex: str, fec_group: int = DEFAULT_FEC_GROUP,
+                 frame_samples: int = FRAME_SAMPLES):
+        self.send = send
+        self.token = bytes.fromhex(token_hex)
+        self.fec_group = fec_group
+        self.frame_samples = frame_samples
+        self.pending = np.array([], dtype=np.int16)
+        self.group = []
+        self.seq = 0
+
+    def push(self, audio: np.ndarray):
+        pcm = (np.clip(audio, -1.0, 1.0) * 32767).astype("<i2")
+        self.pending = np.concatenate([self.pending, pcm])
+        while len(self.pending) >= self.frame_samples:
+            payload = self.pending[:self.frame_samples].tobytes()
+            self.pending = self.pending[self.frame_samples:]
+            self._packet(self.seq, KIND_AUDIO, payload)
+            self.group.append(payload)
+            self.seq += 1
+            if len(self.group) == self.fec_group:
+                self._packet(self.seq // self.fec_group - 1, KIND_PARITY, xor_payloads(self.group))
+                self.group = []
+
+    def _packet(self, seq: int, kind: int, payload: bytes):
+        header = HEADER.pack(self.token, seq, kind, self.fec_group, self.frame_samples)
+        self.send(header + payload)
+
+
+async def _selftest(loss: float, seconds: float):
+    class Collector:
+        def __init__(self):
+            self.frames = []
+
+        def put(self, frame, credited=True):
+            self.frames.append(frame)
+
+    server = DatagramAudioServer(loss=loss)
+    await server.start("127.0.0.1", 0)
+    collector = Collector()
+    info = server.register(collector)
+
+    loop = asyncio.get_running_loop()
+    transport, _ = await loop.create_datagram_endpoint(
+        asyncio.DatagramProtocol, remote_addr=("127.0.0.1", info["port"]))
+    sender = DatagramSender(transport.sendto, info["token"])
+
+    t = np.arange(int(16000 * seconds)) / 16000
+    audio = (0.5 * np.sin(2 * np.pi * 440 * t)).astype(np.float32)
+    for start in range(0, len(audio), 1365):
+        sender.push(audio[start:start + 1365])
+        await asyncio.sleep(0.002)
+    await asyncio.sleep(0.2)
+
+    stats = server.unregister(info["token"])
+    received = np.concatenate(collector.frames) if collector.frames else np.array([])
+    expected = (np.clip(audio, -1, 1) * 32767).astype(np.int16).astype(np.float32) / 32768.0
+    n = len(received)
+    intact = sum(
+        np.array_equal(received[i:i + FRAME_SAMPLES], expected[i:i + FRAME_SAMPLES])
+        for i in range(0, n, FRAME_SAMPLES))
+    print(f"frames sent: {sender.seq}, delivered: {n // FRAME_SAMPLES}, intact: {intact}")
+    print(f"receiver stats: {stats}")
+    transport.close()
+
+
+def main():
+    import argparse
+    parser = argparse.ArgumentParser(description="Datagram audio transport self-test")
+    parser.add_argument("--selftest", action="store_true", help="Run a loopback self-test")
+    parser.add_argument("--loss", type=float, default=0.05, help="Simulated packet loss (0-1)")
+    parser.add_argument("--seconds", type=float, default=10.0, help="Seconds of audio to send")
+    args = parser.parse_args()
+
+    if args.selftest:
+        asyncio.run(_selftest(args.loss, args.seconds))
+    else:
+        parser.print_help()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,92 @@
+"""
+Incremental detokenizer for Moonshine token ids
+
+Python counterpart of electron/detokenizer.mjs, reading the same Hugging Face
+tokenizer.json. It handles SentencePiece-style vocabularies ("▁" for spaces,
+<0xNN> byte fallback) and byte-level BPE ones ("Ġ").
+
+A stream decodes while tokens arrive. Each push returns only the new text.
+A character split across byte tokens, which is common with the Chinese and
+Japanese models, is held back until its last byte arrives. Nothing is
+re-decoded, and no half-character ever reaches a client.
+"""
+
+import codecs
+import json
+import re
+
+BYTE_TOKEN = re.compile(r"^<0x([0-9A-Fa-f]{2})>$")
+
+
+def _byte_level_decoder() -> dict:
+    """GPT-2 byte-level BPE maps every byte to a printable code point."""
+    printable = list(range(33, 127)) + list(range(161, 173)) + list(range(174, 256))
+    codes = printable[:]
+    extra = 0
+    for b in range(256):
+        if b not in printable:
+            printable.append(b)
+            codes.append(256 + extra)
+            extra += 1
+    return {chr(c): b for b, c in zip(printable, codes)}
+
+
+class Detokenizer:
+    """Token ids to text, whole or incrementally (stream())."""
+
+    def __init__(self, tokenizer_json):
+        spec = json.loads(tokenizer_json) if isinstance(tokenizer_json, str) else tokenizer_json
+        vocab = spec["model"]["vocab"]
+        self.tokens = {token_id: token for token, token_id in vocab.items()}
+        self.special = set()
+        for added in spec.get("added_tokens") or []:
+            self.tokens[added["id"]] = added["content"]
+            if added.get("special"):
+                self.special.add(added["id"])
+        self.byte_level = _byte_level_decoder() if "ByteLevel" in json.dumps(spec.get("decoder") or {}) else None
+        self._bytes = {}
+
+    def token_bytes(self, token_id: int) -> bytes:
+        """UTF-8 bytes of one token (memoised)."""
+        cached = self._bytes.get(token_id)
+        if cached is not None:
+            return cached
+        token = self.tokens.get(token_id)
+        if token is None or token_id in self.special:
+            data = b""
+        elif BYTE_TOKEN.match(token):
+            data = bytes([int(token[3:5], 16)])
+        elif self.byte_level:
+            data = bytes(self.byte_level.get(ch, 0x3F) for ch in token)
+        else:
+            data = token.replace("▁", " ").encode("utf-8")
+        self._bytes[token_id] = data
+        return data
+
+    def decode(self, ids) -> str:
+        return b"".join(self.token_bytes(int(i)) for i in ids).decode("utf-8", errors="replace").strip()
+
+    def stream(self) -> "DetokenizerStream":
+        return DetokenizerStream(self)
+
+
+class DetokenizerStream:
+    """Decodes one token sequence as it is generated."""
+
+    def __init__(self, detokenizer: Detokenizer):
+        self.detokenizer = detokenizer
+        self.decoder = codecs.getincrementaldecoder("utf-8")(errors="replace")
+        self.text = ""
+
+    def push(self, token_id: int) -> str:
+        """New complete text from one token ('' while a character is incomplete)."""
+        piece = self.decoder.decode(self.detokenizer.token_bytes(int(token_id)))
+        if not self.text:
+            piece = piece.lstrip()
+        self.text += piece
+        return piece
+
+    def finish(self) -> str:
+        """Everything decoded, with any dangling partial character flushed."""
+        self.text = (self.text + self.decoder.decode(b"", final=True)).strip()
+        return self.text
@@ -0,0 +1,100 @@
+// Backend benchmark for the in-app engines: the same Moonshine models and
+// decode loop on onnxruntime-node (native, in-app engine) and onnxruntime-web
+// (WebAssembly SIMD, WASM engine), on the same short windows.
+//
+// Usage:
+//   node electron/bench-backends.mjs --model moonshine/tiny
+//   node electron/bench-backends.mjs --windows 1,1.5,2 --repeat 20 --threads 1
+//
+// Reports p50/p95 wall time per window and the real-time factor (wall time /
+// audio time). --threads sets the WASM thread count (0: onnxruntime-web's
+// default); the runtime fixes it on first use, so compare thread counts with
+// separate runs. For the Python server's thread policies see bench_engine.py.
+
+import { readFileSync } from 'fs';
+import { createRequire } from 'module';
+import { MoonshineModel } from './moonshine-model.mjs';
+
+const require = createRequire(import.meta.url);
+const { moonshineModelFiles } = require('./model-paths.cjs');
+
+const SAMPLE_RATE = 16000;
+
+function parseArgs(argv) {
+  const args = { model: 'moonshine/tiny', windows: [1, 1.5, 2], repeat: 10, threads: 0 };
+  for (let i = 0; i < argv.length; i += 2) {
+    const [flag, value] = [argv[i], argv[i + 1]];
+    if (flag === '--model') args.model = value;
+    else if (flag === '--windows') args.windows = value.split(',').map(Number);
+    else if (flag === '--repeat') args.repeat = Number(value);
+    else if (flag === '--threads') args.threads = Number(value);
+    else throw new Error(`Unknown option ${flag}`);
+  }
+  return args;
+}
+
+function percentile(values, q) {
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.min(sorted.length - 1, Math.floor((q / 100) * sorted.length))] ?? 0;
+}
+
+// Low-level noise; decode length is bounded by the window, not the content
+function noise(seconds) {
+  const samples = new Float32Array(Math.round(seconds * SAMPLE_RATE));
+  for (let i = 0; i < samples.length; i++) samples[i] = (Math.random() - 0.5) * 0.02;
+  return samples;
+}
+
+async function benchBackend(label, model, windows, repeat) {
+  const rows = [];
+  for (const seconds of windows) {
+    const audio = noise(seconds);
+    await model.generate(audio); // warm-up
+    const times = [];
+    for (let i = 0; i < repeat; i++) {
+      const start = performance.now();
+      await model.generate(audio);
+      times.push(performance.now() - start);
+    }
+    const p50 = percentile(times, 50);
+    rows.push({ backend: label, seconds, p50, p95: percentile(times, 95), rtf: p50 / (seconds * 1000) });
+  }
+  await model.release();
+  return rows;
+}
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const files = moonshineModelFiles(args.model);
+  const encoder = readFileSync(files.encoder);
+  const decoder = readFileSync(files.decoder);
+  const rows = [];
+
+  const ortNode = require('onnxruntime-node');
+  const native = await MoonshineModel.create(ortNode, { encoder, decoder });
+  rows.push(...(await benchBackend('node (native)', native, args.windows, args.repeat)));
+
+  const ortWeb = await import('onnxruntime-web');
+  if (args.threads > 0) ortWeb.env.wasm.numThreads = args.threads;
+  const wasm = await MoonshineModel.create(ortWeb, {
+    encoder: new Uint8Array(encoder),
+    decoder: new Uint8Array(decoder),
+    sessionOptions: { executionProviders: ['wasm'], graphOptimizationLevel: 'all' },
+  });
+  const label = `web (wasm, ${ortWeb.env.wasm.numThreads || 'default'} threads)`;
+  rows.push(...(await benchBackend(label, wasm, args.windows, args.repeat)));
+
+  console.log(`\n${args.model}, ${args.repeat} runs per window\n`);
+  console.log('backend                          window    p50 ms    p95 ms    RTF');
+  for (const row of rows) {
+    console.log(
+      `${row.backend.padEnd(32)} ${`${row.seconds}s`.padStart(6)} ${row.p50.toFixed(1).padStart(9)} ` +
+        `${row.p95.toFixed(1).padStart(9)} ${row.rtf.toFixed(3).padStart(7)}`,
+    );
+  }
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
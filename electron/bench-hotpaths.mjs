@@ -0,0 +1,217 @@
+// Micro-benchmarks for the app's audio and text hot paths: the capture
+// worklet's 16 kHz decimation, the datagram sender's PCM packing, result
+// parsing, the overlay's word split and the streaming detokenizer. Same
+// harness and baseline format as bench_hotpaths.py (the server side).
+//
+// Usage:
+//   node electron/bench-hotpaths.mjs
+//   node electron/bench-hotpaths.mjs --save baseline-js.json
+//   node electron/bench-hotpaths.mjs --compare baseline-js.json --threshold 0.1
+//
+// Each case runs about --min-time seconds per repeat, after a warm-up. V8
+// settles on different code and heap layouts from one process to the next,
+// so the cases run in --processes fresh processes. The median time per call
+// across them is reported, with the spread (median absolute deviation,
+// within or between processes, whichever is larger). With --compare the
+// process exits 1 when a case is slower than the baseline by more than
+// --threshold and by more than three times its spread.
+
+import { execFileSync } from 'child_process';
+import { readFileSync, writeFileSync } from 'fs';
+import { createRequire } from 'module';
+import { fileURLToPath } from 'url';
+import { Detokenizer } from './detokenizer.mjs';
+
+const require = createRequire(import.meta.url);
+const { DatagramSender } = require('./datagram-sender.cjs');
+
+function parseArgs(argv) {
+  const args = { filter: '', repeats: 9, minTime: 0.05, processes: 3, save: null, compare: null, threshold: 0.1 };
+  for (let i = 0; i < argv.length; i += 2) {
+    const [flag, value] = [argv[i], argv[i + 1]];
+    if (flag === '--child') {
+      args.child = true;
+      i--;
+    } else if (flag === '--filter') args.filter = value;
+    else if (flag === '--processes') args.processes = Number(value);
+    else if (flag === '--repeats') args.repeats = Number(value);
+    else if (flag === '--min-time') args.minTime = Number(value);
+    else if (flag === '--save') args.save = value;
+    else if (flag === '--compare') args.compare = value;
+    else if (flag === '--threshold') args.threshold = Number(value);
+    else throw new Error(`Unknown option ${flag}`);
+  }
+  return args;
+}
+
+function median(values) {
+  const sorted = [...values].sort((a, b) => a - b);
+  const mid = sorted.length >> 1;
+  return sorted.length % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
+
+function measure(fn, repeats, minTime) {
+  // Let the JIT settle on optimised code before anything is timed
+  const warmUntil = process.hrtime.bigint() + BigInt(Math.round(minTime * 4e9));
+  while (process.hrtime.bigint() < warmUntil) fn();
+
+  let number = 1;
+  let elapsed;
+  for (;;) {
+    const started = process.hrtime.bigint();
+    for (let i = 0; i < number; i++) fn();
+    elapsed = Number(process.hrtime.bigint() - started) / 1e9;
+    if (elapsed >= minTime / 4) break;
+    number *= 4;
+  }
+  number = Math.max(1, Math.floor((number * minTime) / elapsed));
+  const samples = [];
+  for (let r = 0; r < repeats; r++) {
+    const started = process.hrtime.bigint();
+    for (let i = 0; i < number; i++) fn();
+    samples.push(Number(process.hrtime.bigint() - started) / number);
+  }
+  const ns = median(samples);
+  const spread = ns ? median(samples.map((s) => Math.abs(s - ns))) / ns : 0;
+  return { ns: Math.round(ns * 10) / 10, spread: Math.round(spread * 1e4) / 1e4, calls: number };
+}
+
+function formatNs(ns) {
+  if (ns >= 1e6) return `${(ns / 1e6).toFixed(2)} ms`;
+  if (ns >= 1e3) return `${(ns / 1e3).toFixed(2)} µs`;
+  return `${ns.toFixed(0)} ns`;
+}
+
+// Load public/capture-worklet.js as is, with just enough of the
+// AudioWorkletGlobalScope around it
+function loadWorklet(rate) {
+  let registered = null;
+  globalThis.sampleRate = rate;
+  globalThis.AudioWorkletProcessor = class {
+    constructor() {
+      this.port = {};
+    }
+  };
+  globalThis.registerProcessor = (name, processor) => {
+    registered = processor;
+  };
+  require('../public/capture-worklet.js');
+  return registered;
+}
+
+// The overlay's word limit (public/overlay.html, showSubtitle)
+function overlayWords(text, maxLines) {
+  const words = text.trim().split(/\s+/);
+  return words.slice(-maxLines * 8).join(' ');
+}
+
+function cases() {
+  const Processor = loadWorklet(48000);
+  const worklet = new Processor({ processorOptions: { targetRate: 16000, frameSamples: 1365 } });
+  worklet.sink = { postMessage() {} };
+  const quantum = [[Float32Array.from({ length: 128 }, (_, i) => Math.sin(i / 7) * 0.1)]];
+
+  // loss 1: every packet is built, then dropped before the socket
+  const sender = new DatagramSender({ host: '127.0.0.1', port: 9, token: '00'.repeat(8), loss: 1 });
+  const tenth = Float32Array.from({ length: 1600 }, (_, i) => Math.sin(i / 11) * 0.1);
+
+  const message = JSON.stringify({
+    segments: [{ id: 42, rev: 0, text: 'and that is why the meeting moved to Thursday', start: 12.345, end: 14.345 }],
+  });
+  const caption = 'and that is why the meeting moved to Thursday after all, since half of the team was still away';
+
+  const words = 'and that is why the meeting moved to thursday'.split(' ');
+  const vocab = { '<s>': 1, '</s>': 2, '<0xE4>': 3, '<0xB8>': 4, '<0xAD>': 5 };
+  words.forEach((w, i) => (vocab[`▁${w}`] = 10 + i));
+  const detokenizer = new Detokenizer({
+    model: { vocab },
+    added_tokens: [
+      { id: 1, content: '<s>', special: true },
+      { id: 2, content: '</s>', special: true },
+    ],
+  });
+  const tokens = [...words.map((_, i) => 10 + i), 3, 4, 5, 2];
+
+  return {
+    cleanup: () => sender.close(),
+    cases: {
+      // One 128-sample render quantum at 48 kHz
+      worklet_decimate_128: () => worklet.process(quantum),
+      datagram_pack_100ms: () => sender.push(tenth),
+      json_parse_segment: () => JSON.parse(message),
+      overlay_word_split: () => overlayWords(caption, 2),
+      detokenize_stream_13: () => {
+        const stream = detokenizer.stream();
+        for (const token of tokens) stream.push(token);
+        stream.finish();
+      },
+    },
+  };
+}
+
+// One process's measurements, printed as JSON for the parent
+function runChild(args) {
+  const { cases: all, cleanup } = cases();
+  const results = {};
+  for (const [name, fn] of Object.entries(all)) {
+    if (name.includes(args.filter)) results[name] = measure(fn, args.repeats, args.minTime);
+  }
+  cleanup();
+  process.stdout.write(JSON.stringify(results));
+}
+
+function combine(runs) {
+  const results = {};
+  for (const name of Object.keys(runs[0])) {
+    const times = runs.map((run) => run[name].ns);
+    const ns = median(times);
+    const between = ns ? median(times.map((t) => Math.abs(t - ns))) / ns : 0;
+    const within = median(runs.map((run) => run[name].spread));
+    results[name] = {
+      ns: Math.round(ns * 10) / 10,
+      spread: Math.round(Math.max(between, within) * 1e4) / 1e4,
+      calls: runs[0][name].calls,
+    };
+  }
+  return results;
+}
+
+const args = parseArgs(process.argv.slice(2));
+if (args.child) {
+  runChild(args);
+  process.exit(0);
+}
+
+const baseline = args.compare ? JSON.parse(readFileSync(args.compare, 'utf8')).results : {};
+const childArgs = [fileURLToPath(import.meta.url), '--child', '--filter', args.filter,
+  '--repeats', String(args.repeats), '--min-time', String(args.minTime)];
+const runs = [];
+for (let i = 0; i < args.processes; i++) {
+  runs.push(JSON.parse(execFileSync(process.execPath, childArgs, { encoding: 'utf8' })));
+}
+const results = combine(runs);
+const regressions = [];
+
+console.log(`${'case'.padEnd(24)} ${'time'.padStart(12)} ${'spread'.padStart(7)} ${'baseline'.padStart(12)} ${'change'.padStart(8)}`);
+for (const [name, result] of Object.entries(results)) {
+  let line = `${name.padEnd(24)} ${formatNs(result.ns).padStart(12)} ${`${(result.spread * 100).toFixed(1)}%`.padStart(7)}`;
+  const before = baseline[name];
+  if (before) {
+    const change = (result.ns - before.ns) / before.ns;
+    line += ` ${formatNs(before.ns).padStart(12)} ${`${change >= 0 ? '+' : ''}${(change * 100).toFixed(1)}%`.padStart(8)}`;
+    if (change > args.threshold && change > 3 * Math.max(result.spread, before.spread)) {
+      regressions.push(name);
+      line += '  REGRESSION';
+    }
+  }
+  console.log(line);
+}
+
+if (args.save) {
+  writeFileSync(args.save, JSON.stringify({ node: process.version, processes: args.processes, results }, null, 2));
+  console.log(`\nBaseline written to ${args.save}`);
+}
+if (regressions.length) {
+  console.log(`\n${regressions.length} regression(s): ${regressions.join(', ')}`);
+  process.exit(1);
+}
@@ -0,0 +1,74 @@
+const dgram = require('dgram');
+
+// Packet layout matches datagram_transport.py:
+// token (8 bytes) | seq (uint32) | kind (uint8) | group (uint8) | samples (uint16) | int16 PCM
+const HEADER_BYTES = 16;
+const KIND_AUDIO = 0;
+const KIND_PARITY = 1;
+
+// Sends 16 kHz audio as sequenced UDP datagrams with one XOR parity packet per group
+class DatagramSender {
+  constructor({ host, port, token, frameSamples = 320, fecGroup = 4, loss = 0 }) {
+    this.host = host;
+    this.port = port;
+    this.token = Buffer.from(token, 'hex');
+    this.frameSamples = frameSamples;
+    this.fecGroup = fecGroup;
+    // Simulated send-side loss for testing over loopback
+    this.loss = loss;
+    this.socket = dgram.createSocket(host.includes(':') ? 'udp6' : 'udp4');
+    this.pending = new Int16Array(frameSamples);
+    this.pendingLength = 0;
+    this.group = [];
+    this.seq = 0;
+  }
+
+  push(samples) {
+    for (let i = 0; i < samples.length; i++) {
+      const sample = Math.max(-1, Math.min(1, samples[i]));
+      this.pending[this.pendingLength++] = sample * 32767;
+      if (this.pendingLength === this.frameSamples) {
+        this.flushFrame();
+      }
+    }
+  }
+
+  flushFrame() {
+    const payload = Buffer.from(this.pending.buffer.slice(0));
+    this.pendingLength = 0;
+    this.sendPacket(this.seq, KIND_AUDIO, payload);
+    this.group.push(payload);
+    this.seq++;
+
+    if (this.group.length === this.fecGroup) {
+      const parity = Buffer.alloc(payload.length);
+      for (const frame of this.group) {
+        for (let i = 0; i < parity.length; i++) {
+          parity[i] ^= frame[i];
+        }
+      }
+      this.sendPacket(this.seq / this.fecGroup - 1, KIND_PARITY, parity);
+      this.group = [];
+    }
+  }
+
+  sendPacket(seq, kind, payload) {
+    if (this.loss && Math.random() < this.loss) {
+      return;
+    }
+    const packet = Buffer.alloc(HEADER_BYTES + payload.length);
+    this.token.copy(packet, 0);
+    packet.writeUInt32LE(seq, 8);
+    packet.writeUInt8(kind, 12);
+    packet.writeUInt8(this.fecGroup, 13);
+    packet.writeUInt16LE(this.frameSamples, 14);
+    payload.copy(packet, HEADER_BYTES);
+    this.socket.send(packet, this.port, this.host);
+  }
+
+  close() {
+    this.socket.close();
+  }
+}
+
+module.exports = { DatagramSender };
@@ -0,0 +1,13 @@
+// Types for detokenizer.mjs, used by the WASM worker in src/
+export declare class Detokenizer {
+  constructor(tokenizerJson: string | object);
+  tokenBytes(id: number): number[];
+  decode(ids: number[]): string;
+  stream(): DetokenizerStream;
+}
+
+export declare class DetokenizerStream {
+  text: string;
+  push(id: number): string;
+  finish(): string;
+}
@@ -0,0 +1,100 @@
+// Turns Moonshine token ids back into text, using the model's tokenizer.json
+// (Hugging Face tokenizers format). Handles SentencePiece-style vocabularies
+// ("▁" for spaces, <0xNN> byte fallback) and byte-level BPE ones ("Ġ").
+// Shared by the Electron engine process and the WASM worker; detokenizer.py
+// is the Python counterpart used by the Moonshine server.
+//
+// stream() decodes incrementally while tokens arrive. Each push returns only
+// the new text, and a character split across byte tokens (common with the
+// Chinese and Japanese models) is held back until its last byte arrives.
+
+const BYTE_TOKEN = /^<0x([0-9A-Fa-f]{2})>$/;
+
+// GPT-2 byte-level BPE maps every byte to a printable code point
+function byteLevelDecoder() {
+  const bytes = [];
+  for (let b = 33; b <= 126; b++) bytes.push(b);
+  for (let b = 161; b <= 172; b++) bytes.push(b);
+  for (let b = 174; b <= 255; b++) bytes.push(b);
+  const chars = bytes.slice();
+  let extra = 0;
+  for (let b = 0; b < 256; b++) {
+    if (!bytes.includes(b)) {
+      bytes.push(b);
+      chars.push(256 + extra++);
+    }
+  }
+  const table = new Map();
+  bytes.forEach((b, i) => table.set(String.fromCodePoint(chars[i]), b));
+  return table;
+}
+
+export class Detokenizer {
+  constructor(tokenizerJson) {
+    const spec = typeof tokenizerJson === 'string' ? JSON.parse(tokenizerJson) : tokenizerJson;
+    this.tokens = [];
+    for (const [token, id] of Object.entries(spec.model.vocab)) {
+      this.tokens[id] = token;
+    }
+    this.special = new Set();
+    for (const added of spec.added_tokens || []) {
+      this.tokens[added.id] = added.content;
+      if (added.special) {
+        this.special.add(added.id);
+      }
+    }
+    const decoderTypes = JSON.stringify(spec.decoder || {});
+    this.byteLevel = decoderTypes.includes('ByteLevel') ? byteLevelDecoder() : null;
+    this.utf8 = new TextEncoder();
+    this.text = new TextDecoder('utf-8');
+  }
+
+  // UTF-8 bytes of one token
+  tokenBytes(id) {
+    const token = this.tokens[id];
+    if (token === undefined || this.special.has(id)) {
+      return [];
+    }
+    const byte = BYTE_TOKEN.exec(token);
+    if (byte) {
+      return [parseInt(byte[1], 16)];
+    }
+    if (this.byteLevel) {
+      return Array.from(token, (ch) => this.byteLevel.get(ch) ?? 0x3f);
+    }
+    return Array.from(this.utf8.encode(token.replaceAll('▁', ' ')));
+  }
+
+  decode(ids) {
+    const bytes = ids.flatMap((id) => this.tokenBytes(id));
+    return this.text.decode(new Uint8Array(bytes)).trim();
+  }
+
+  stream() {
+    return new DetokenizerStream(this);
+  }
+}
+
+export class DetokenizerStream {
+  constructor(detokenizer) {
+    this.detokenizer = detokenizer;
+    this.decoder = new TextDecoder('utf-8');
+    this.text = '';
+  }
+
+  // New complete text from one token ('' while a character is incomplete)
+  push(id) {
+    let piece = this.decoder.decode(new Uint8Array(this.detokenizer.tokenBytes(id)), { stream: true });
+    if (!this.text) {
+      piece = piece.trimStart();
+    }
+    this.text += piece;
+    return piece;
+  }
+
+  // Everything decoded, with any dangling partial character flushed
+  finish() {
+    this.text = (this.text + this.decoder.decode()).trim();
+    return this.text;
+  }
+}
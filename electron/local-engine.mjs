@@ -0,0 +1,113 @@
+// In-app transcription engine, run by the main process as an Electron
+// utilityProcess. Moonshine runs on onnxruntime-node (a native N-API addon)
+// with no Python, no loopback sockets and no temporary WAV files.
+//
+// The main process hands over three MessagePorts per capture session:
+//   audio   - Float32Array frames (16 kHz) posted by the capture worklet
+//   control - config in, server-style status and results out
+//   overlay - {type: 'subtitle', text} straight to the overlay window
+//
+// Models are located by model-paths.cjs.
+
+import { createRequire } from 'node:module';
+import { readFile } from 'node:fs/promises';
+import { MoonshineModel } from './moonshine-model.mjs';
+import { Detokenizer } from './detokenizer.mjs';
+import { StreamSession } from './stream-session.mjs';
+import modelPaths from './model-paths.cjs';
+
+const require = createRequire(import.meta.url);
+
+let ort = null;
+let loaded = null; // { name, model, detokenizer }
+let ports = [];
+let session = null;
+
+async function loadModel(name, emit) {
+  if (loaded && loaded.name === name) {
+    return true;
+  }
+  emit({ type: 'model_loading', model: name, progress: 0 });
+  try {
+    ort = ort || require('onnxruntime-node');
+    const files = modelPaths.moonshineModelFiles(name);
+    const [model, tokenizer] = await Promise.all([
+      MoonshineModel.create(ort, {
+        encoder: files.encoder,
+        decoder: files.decoder,
+        sessionOptions: { executionProviders: ['cpu'], graphOptimizationLevel: 'all' },
+      }),
+      readFile(files.tokenizer, 'utf8'),
+    ]);
+    if (loaded) {
+      await loaded.model.release();
+    }
+    loaded = { name, model, detokenizer: new Detokenizer(tokenizer) };
+    emit({ type: 'model_ready', model: name, progress: 100 });
+    return true;
+  } catch (error) {
+    console.error(`[local-engine] Failed to load ${name}:`, error);
+    emit({ type: 'model_error', model: name, error: String(error.message || error) });
+    return false;
+  }
+}
+
+async function transcribe(samples, onPartial) {
+  const { model, detokenizer } = loaded;
+  const stream = detokenizer.stream();
+  await model.generate(samples, (id) => {
+    if (stream.push(id)) {
+      onPartial(stream.text);
+    }
+  });
+  return stream.finish();
+}
+
+function stopSession() {
+  if (session) {
+    session.close();
+    session = null;
+  }
+  ports.forEach((port) => port.close());
+  ports = [];
+}
+
+async function startSession(model, [audio, control, overlay]) {
+  stopSession();
+  ports = [audio, control, overlay];
+  const emit = (message) => control.postMessage(message);
+  const current = new StreamSession({
+    transcribe,
+    emit,
+    overlay: (text) => overlay.postMessage({ type: 'subtitle', text }),
+    backend: 'local',
+  });
+  session = current;
+
+  control.on('message', async ({ data }) => {
+    if (data.type === 'stop') {
+      stopSession();
+    } else if (data.model && session === current) {
+      await loadModel(data.model, emit);
+    }
+  });
+  audio.on('message', ({ data }) => {
+    if (loaded) {
+      current.push(data);
+    }
+  });
+  control.start();
+  audio.start();
+
+  if (await loadModel(model, emit) && session === current) {
+    emit({ message: 'SERVER_READY', status: 'ready', backend: 'local', model: loaded.name });
+  }
+}
+
+process.parentPort.on('message', ({ data, ports: transferred }) => {
+  if (data.type === 'start') {
+    startSession(data.model, transferred);
+  } else if (data.type === 'stop') {
+    stopSession();
+  }
+});
@@ -1,11 +1,36 @@
-const { app, BrowserWindow, ipcMain, desktopCapturer, screen } = require('electron');
+const { app, BrowserWindow, ipcMain, desktopCapturer, screen, utilityProcess, MessageChannelMain } = require('electron');
 const path = require('path');
+const readline = require('readline');
+const { spawn, execFile } = require('child_process');
+const fs = require('fs');
+const { DatagramSender } = require('./datagram-sender.cjs');
+const { moonshineModelFiles } = require('./model-paths.cjs');
+const { ServerPool } = require('./server-pool.cjs');
+const { TranscriptStore } = require('./transcript-store.cjs');
 
 let settingsWindow = null;
 let overlayWindow = null;
+let captureWindow = null;
+let datagramSender = null;
+let appCapture = null;
+let localEngine = null;
+
+// Transcription servers the capture pipeline may use, probed for health/load
+const serverPool = new ServerPool((status) => {
+  if (settingsWindow && !settingsWindow.isDestroyed()) {
+    settingsWindow.webContents.send('servers-status', status);
+  }
+});
+
+// Every capture session's segments, saved and searchable
+const transcriptStore = new TranscriptStore(path.join(app.getPath('userData'), 'transcripts'));
 
 const isDev = process.env.NODE_ENV === 'development';
 
+// Linux per-application capture helper (PipeWire/PulseAudio)
+const pythonBin = process.env.SFA_PYTHON || 'python3';
+const captureHelper = path.join(__dirname, '..', 'linux_capture.py');
+
 function createSettingsWindow() {
   settingsWindow = new BrowserWindow({
     width: 900,
@@ -38,6 +63,9 @@ function createSettingsWindow() {
     if (overlayWindow) {
       overlayWindow.close();
     }
+    if (captureWindow) {
+      captureWindow.close();
+    }
     app.quit();
   });
 }
@@ -86,11 +114,54 @@ function createOverlayWindow() {
   return overlayWindow;
 }
 
-app.commandLine.appendSwitch('enable-features', 'ScreenCaptureKitPicker');
+// Hidden window that runs the capture pipeline (src/capture.ts). It is never
+// shown and background throttling is off, so frame delivery does not depend
+// on whether the settings window is minimised or covered.
+function createCaptureWindow() {
+  captureWindow = new BrowserWindow({
+    show: false,
+    webPreferences: {
+      nodeIntegration: false,
+      contextIsolation: true,
+      backgroundThrottling: false,
+      preload: path.join(__dirname, 'preload.cjs'),
+    },
+  });
+
+  if (isDev) {
+    captureWindow.loadURL('http://localhost:5173/capture.html');
+  } else {
+    captureWindow.loadFile(path.join(__dirname, '../dist/capture.html'));
+  }
+
+  captureWindow.on('closed', () => {
+    captureWindow = null;
+  });
+
+  return captureWindow;
+}
+
+// Send a command to the capture window once its page has loaded
+function sendCaptureCommand(command) {
+  if (!captureWindow || captureWindow.isDestroyed()) {
+    createCaptureWindow();
+  }
+  const contents = captureWindow.webContents;
+  if (contents.isLoading()) {
+    contents.once('did-finish-load', () => contents.send('capture-command', command));
+  } else {
+    contents.send('capture-command', command);
+  }
+}
+
+// SharedArrayBuffer lets the WASM engine share model bytes and run threads
+// without cross-origin isolation headers (pages are loaded from file://)
+app.commandLine.appendSwitch('enable-features', 'ScreenCaptureKitPicker,SharedArrayBuffer');
 
 app.whenReady().then(() => {
   createSettingsWindow();
   createOverlayWindow();
+  createCaptureWindow();
 
   app.on('activate', () => {
     if (BrowserWindow.getAllWindows().length === 0) {
@@ -173,3 +244,217 @@ ipcMain.on('clear-subtitle', () => {
     overlayWindow.webContents.send('subtitle-update', '');
   }
 });
+
+// Datagram audio transport (the renderer cannot open UDP sockets)
+ipcMain.on('datagram-open', (event, options) => {
+  if (datagramSender) {
+    datagramSender.close();
+  }
+  datagramSender = new DatagramSender({
+    ...options,
+    loss: parseFloat(process.env.SFA_DATAGRAM_LOSS || '0'),
+  });
+});
+
+ipcMain.on('datagram-audio', (event, samples) => {
+  if (datagramSender) {
+    datagramSender.push(samples);
+  }
+});
+
+ipcMain.on('datagram-close', () => {
+  if (datagramSender) {
+    datagramSender.close();
+    datagramSender = null;
+  }
+});
+
+// Capture pipeline in the hidden capture window: commands in from the
+// settings window, server messages and telemetry back out to it
+ipcMain.on('capture-start', (event, options) => {
+  sendCaptureCommand({ type: 'start', ...options });
+});
+
+ipcMain.on('capture-config', (event, config) => {
+  sendCaptureCommand({ type: 'config', config });
+});
+
+ipcMain.on('capture-stop', () => {
+  if (captureWindow && !captureWindow.isDestroyed()) {
+    captureWindow.webContents.send('capture-command', { type: 'stop' });
+  }
+});
+
+// Server list from the settings window; the capture window asks for the best
+// server when it starts and again when it fails over
+ipcMain.on('servers-configure', (event, urls) => {
+  serverPool.setServers(urls);
+});
+
+async function pickServer({ exclude = [], failed = null } = {}) {
+  if (failed) {
+    serverPool.markDown(failed);
+  }
+  let url = serverPool.pick(exclude);
+  if (!url) {
+    // Everything looks down; probe again before giving up
+    await serverPool.probeAll();
+    url = serverPool.pick(exclude);
+  }
+  return url;
+}
+
+ipcMain.handle('servers-pick', (event, options) => pickServer(options));
+
+ipcMain.on('capture-message', (event, message) => {
+  if (settingsWindow && !settingsWindow.isDestroyed()) {
+    settingsWindow.webContents.send('capture-message', message);
+  }
+});
+
+// Per-application capture on Linux: list playback streams
+ipcMain.handle('get-app-audio-streams', () => new Promise((resolve) => {
+  if (process.platform !== 'linux') {
+    resolve([]);
+    return;
+  }
+  execFile(pythonBin, [captureHelper, 'list'], (error, stdout) => {
+    if (error) {
+      console.error('Error listing application audio streams:', error);
+      resolve([]);
+      return;
+    }
+    try {
+      resolve(JSON.parse(stdout));
+    } catch (parseError) {
+      resolve([]);
+    }
+  });
+}));
+
+function stopAppCapture() {
+  if (appCapture) {
+    appCapture.kill();
+    appCapture = null;
+  }
+}
+
+// Start streaming one application's audio to the server; the helper's
+// stdout carries the server's messages as JSON lines. When its connection
+// drops it asks for the next server, as the capture window does.
+ipcMain.on('app-capture-start', (event, { sinkInput, serverUrl, config }) => {
+  stopAppCapture();
+  const child = spawn(pythonBin, [
+    captureHelper, 'capture',
+    '--sink-input', String(sinkInput),
+    '--server', serverUrl,
+    '--config', JSON.stringify(config),
+    '--ask-server',
+  ]);
+  appCapture = child;
+
+  const sender = event.sender;
+  readline.createInterface({ input: child.stdout }).on('line', async (line) => {
+    if (line.startsWith('{"type": "pick_server"')) {
+      const url = await pickServer(JSON.parse(line));
+      if (!child.killed && child.exitCode === null) {
+        child.stdin.write(JSON.stringify({ type: 'server_picked', url }) + '\n');
+      }
+      return;
+    }
+    if (!sender.isDestroyed()) {
+      sender.send('app-capture-message', line);
+    }
+  });
+  child.stderr.on('data', (data) => console.error(`[linux_capture] ${data}`));
+  child.on('exit', (code) => {
+    if (appCapture === child) {
+      appCapture = null;
+    }
+    if (!sender.isDestroyed()) {
+      sender.send('app-capture-message', JSON.stringify({ type: 'capture_ended', code }));
+    }
+  });
+});
+
+// Forward config changes (model, language) to the helper's server connection
+ipcMain.on('app-capture-config', (event, config) => {
+  if (appCapture) {
+    appCapture.stdin.write(JSON.stringify(config) + '\n');
+  }
+});
+
+ipcMain.on('app-capture-stop', () => {
+  stopAppCapture();
+});
+
+// In-app engine (Moonshine on onnxruntime-node) in a utility process. The
+// capture worklet and the overlay talk to it over MessagePorts, so audio and
+// captions never pass through this process.
+function getLocalEngine() {
+  if (!localEngine) {
+    localEngine = utilityProcess.fork(path.join(__dirname, 'local-engine.mjs'), [], {
+      serviceName: 'SubtitlesForAll Engine',
+    });
+    localEngine.on('exit', (code) => {
+      localEngine = null;
+      if (settingsWindow && !settingsWindow.isDestroyed()) {
+        settingsWindow.webContents.send('local-engine-exit', code);
+      }
+    });
+  }
+  return localEngine;
+}
+
+ipcMain.on('local-engine-start', (event, { model }) => {
+  const audio = new MessageChannelMain();
+  const control = new MessageChannelMain();
+  const overlay = new MessageChannelMain();
+  getLocalEngine().postMessage({ type: 'start', model }, [audio.port2, control.port2, overlay.port2]);
+  event.sender.postMessage('local-engine-ports', null, [audio.port1, control.port1]);
+  if (overlayWindow && !overlayWindow.isDestroyed()) {
+    overlayWindow.webContents.postMessage('overlay-port', null, [overlay.port1]);
+  }
+});
+
+ipcMain.on('local-engine-stop', () => {
+  if (localEngine) {
+    localEngine.postMessage({ type: 'stop' });
+  }
+});
+
+// WASM engine: model files for the worker, read from the same place as the
+// in-app engine's
+ipcMain.handle('read-model-files', async (event, model) => {
+  const files = moonshineModelFiles(model);
+  const [encoder, decoder, tokenizer] = await Promise.all([
+    fs.promises.readFile(files.encoder),
+    fs.promises.readFile(files.decoder),
+    fs.promises.readFile(files.tokenizer, 'utf8'),
+  ]);
+  return { encoder, decoder, tokenizer };
+});
+
+// Transcript history: the settings window records the segments it receives
+// from every backend, and searches them
+ipcMain.handle('transcript-start', (event, info) => transcriptStore.startSession(info));
+
+ipcMain.on('transcript-record', (event, segments) => {
+  transcriptStore.record(segments);
+});
+
+ipcMain.on('transcript-end', () => {
+  transcriptStore.endSession();
+});
+
+ipcMain.handle('transcript-search', (event, options) => transcriptStore.search(options));
+
+ipcMain.handle('transcript-context', (event, options) => transcriptStore.context(options));
+
+app.on('will-quit', () => {
+  serverPool.stop();
+  transcriptStore.endSession();
+  if (localEngine) {
+    localEngine.kill();
+  }
+});
@@ -0,0 +1,18 @@
+// Where the in-app engines find their Moonshine models: SFA_MOONSHINE_DIR,
+// else ../models/moonshine next to the repository (where the servers look).
+// One directory per size (tiny/, base/) holding encoder_model.onnx,
+// decoder_model_merged.onnx and tokenizer.json.
+const path = require('path');
+
+const modelRoot = process.env.SFA_MOONSHINE_DIR || path.join(__dirname, '..', '..', 'models', 'moonshine');
+
+function moonshineModelFiles(name) {
+  const dir = path.join(modelRoot, name.replace(/^moonshine\//, ''));
+  return {
+    encoder: path.join(dir, 'encoder_model.onnx'),
+    decoder: path.join(dir, 'decoder_model_merged.onnx'),
+    tokenizer: path.join(dir, 'tokenizer.json'),
+  };
+}
+
+module.exports = { moonshineModelFiles };
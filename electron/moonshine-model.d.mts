@@ -0,0 +1,12 @@
+// Types for moonshine-model.mjs, used by the WASM worker in src/
+export interface MoonshineModelOptions {
+  encoder: string | Uint8Array;
+  decoder: string | Uint8Array;
+  sessionOptions?: Record<string, unknown>;
+}
+
+export declare class MoonshineModel {
+  static create(ort: unknown, options: MoonshineModelOptions): Promise<MoonshineModel>;
+  generate(samples: Float32Array, onToken?: ((id: number) => void) | null): Promise<number[]>;
+  release(): Promise<void>;
+}
@@ -0,0 +1,96 @@
+// Moonshine speech recognition on ONNX Runtime. The caller passes in the
+// runtime: onnxruntime-node in the Electron engine process, onnxruntime-web
+// in the WASM worker. The greedy decode loop mirrors moonshine_engine.py.
+
+const DECODER_START_TOKEN = 1;
+const EOS_TOKEN = 2;
+const TOKENS_PER_SECOND = 6; // decode budget, as in moonshine-onnx
+const SAMPLE_RATE = 16000;
+
+// Key/value cache geometry by decoder depth (tiny: 6 layers, base: 8)
+const CACHE_SHAPES = {
+  6: { heads: 8, headDim: 36 },
+  8: { heads: 8, headDim: 52 },
+};
+
+export class MoonshineModel {
+  // encoder/decoder: file path (node) or model bytes (node and web)
+  static async create(ort, { encoder, decoder, sessionOptions = {} }) {
+    const [encoderSession, decoderSession] = await Promise.all([
+      ort.InferenceSession.create(encoder, sessionOptions),
+      ort.InferenceSession.create(decoder, sessionOptions),
+    ]);
+    return new MoonshineModel(ort, encoderSession, decoderSession);
+  }
+
+  constructor(ort, encoder, decoder) {
+    this.ort = ort;
+    this.encoder = encoder;
+    this.decoder = decoder;
+    this.cacheNames = decoder.inputNames.filter((name) => name.startsWith('past_key_values.'));
+    const layers = this.cacheNames.length / 4;
+    this.cacheShape = CACHE_SHAPES[layers] ?? CACHE_SHAPES[6];
+  }
+
+  // 16 kHz mono samples in, token ids out; onToken(id) sees each as it is decoded
+  async generate(samples, onToken = null) {
+    const { Tensor } = this.ort;
+    const encoded = await this.encoder.run({
+      input_values: new Tensor('float32', samples, [1, samples.length]),
+    });
+    const hidden = encoded[this.encoder.outputNames[0]];
+
+    const { heads, headDim } = this.cacheShape;
+    const empty = new Tensor('float32', new Float32Array(0), [0, heads, 1, headDim]);
+    let past = Object.fromEntries(this.cacheNames.map((name) => [name, empty]));
+
+    const tokens = [DECODER_START_TOKEN];
+    let inputIds = tokens.slice();
+    const maxLen = Math.floor((samples.length / SAMPLE_RATE) * TOKENS_PER_SECOND);
+    for (let step = 0; step < maxLen; step++) {
+      const useCache = step > 0;
+      const outputs = await this.decoder.run({
+        input_ids: new Tensor('int64', BigInt64Array.from(inputIds, (id) => BigInt(id)), [1, inputIds.length]),
+        encoder_hidden_states: hidden,
+        use_cache_branch: new Tensor('bool', [useCache], [1]),
+        ...past,
+      });
+
+      const token = argmaxLast(outputs[this.decoder.outputNames[0]]);
+      tokens.push(token);
+      onToken?.(token);
+      if (token === EOS_TOKEN) {
+        break;
+      }
+      inputIds = [token];
+
+      // Cross-attention cache is computed once, on the first step
+      const next = {};
+      for (const name of this.cacheNames) {
+        next[name] = !useCache || name.includes('.decoder.')
+          ? outputs[name.replace('past_key_values', 'present')]
+          : past[name];
+      }
+      past = next;
+    }
+    return tokens;
+  }
+
+  async release() {
+    await Promise.all([this.encoder.release?.(), this.decoder.release?.()]);
+  }
+}
+
+// Index of the largest logit at the last position of a [1, seq, vocab] tensor
+function argmaxLast(logits) {
+  const vocab = logits.dims[2];
+  const offset = (logits.dims[1] - 1) * vocab;
+  const data = logits.data;
+  let best = 0;
+  for (let i = 1; i < vocab; i++) {
+    if (data[offset + i] > data[offset + best]) {
+      best = i;
+    }
+  }
+  return best;
+}
@@ -1,6 +1,13 @@
 const { contextBridge, ipcRenderer } = require('electron');
 
+// MessagePorts cannot cross the context bridge; hand them to the page with
+// window.postMessage instead
+ipcRenderer.on('local-engine-ports', (event) => window.postMessage('local-engine-ports', '*', event.ports));
+ipcRenderer.on('overlay-port', (event) => window.postMessage('overlay-port', '*', event.ports));
+
 contextBridge.exposeInMainWorld('electronAPI', {
+  platform: process.platform,
+
   // Get available screen/window sources for capture
   getSources: () => ipcRenderer.invoke('get-sources'),
 
@@ -16,6 +23,66 @@ contextBridge.exposeInMainWorld('electronAPI', {
   // Toggle overlay visibility
   toggleOverlay: (visible) => ipcRenderer.send('toggle-overlay', visible),
 
+  // Datagram audio transport, sent from the main process over UDP
+  openDatagramTransport: (options) => ipcRenderer.send('datagram-open', options),
+  sendAudioDatagram: (samples) => ipcRenderer.send('datagram-audio', samples),
+  closeDatagramTransport: () => ipcRenderer.send('datagram-close'),
+
+  // Capture pipeline in the hidden capture window (settings window side)
+  startCapture: (options) => ipcRenderer.send('capture-start', options),
+  sendCaptureConfig: (config) => ipcRenderer.send('capture-config', config),
+  stopCapture: () => ipcRenderer.send('capture-stop'),
+  onCaptureMessage: (callback) => {
+    const listener = (event, message) => callback(message);
+    ipcRenderer.on('capture-message', listener);
+    return () => ipcRenderer.removeListener('capture-message', listener);
+  },
+
+  // Server list: probed by the main process, which picks the least-loaded one
+  configureServers: (urls) => ipcRenderer.send('servers-configure', urls),
+  pickServer: (options) => ipcRenderer.invoke('servers-pick', options),
+  onServersStatus: (callback) => {
+    const listener = (event, status) => callback(status);
+    ipcRenderer.on('servers-status', listener);
+    return () => ipcRenderer.removeListener('servers-status', listener);
+  },
+
+  // Capture window side: commands in, server messages and telemetry out
+  onCaptureCommand: (callback) => {
+    ipcRenderer.on('capture-command', (event, command) => callback(command));
+  },
+  sendCaptureMessage: (message) => ipcRenderer.send('capture-message', message),
+
+  // Per-application capture on Linux through the PipeWire/PulseAudio helper
+  getAppAudioStreams: () => ipcRenderer.invoke('get-app-audio-streams'),
+  startAppCapture: (options) => ipcRenderer.send('app-capture-start', options),
+  sendAppCaptureConfig: (config) => ipcRenderer.send('app-capture-config', config),
+  stopAppCapture: () => ipcRenderer.send('app-capture-stop'),
+  onAppCaptureMessage: (callback) => {
+    const listener = (event, line) => callback(line);
+    ipcRenderer.on('app-capture-message', listener);
+    return () => ipcRenderer.removeListener('app-capture-message', listener);
+  },
+
+  // In-app engine; its ports arrive as a 'local-engine-ports' window message
+  startLocalEngine: (options) => ipcRenderer.send('local-engine-start', options),
+  stopLocalEngine: () => ipcRenderer.send('local-engine-stop'),
+  onLocalEngineExit: (callback) => {
+    const listener = (event, code) => callback(code);
+    ipcRenderer.on('local-engine-exit', listener);
+    return () => ipcRenderer.removeListener('local-engine-exit', listener);
+  },
+
+  // WASM engine: Moonshine model bytes and tokenizer for the worker
+  readModelFiles: (model) => ipcRenderer.invoke('read-model-files', model),
+
+  // Transcript history, saved and indexed by the main process
+  startTranscriptSession: (info) => ipcRenderer.invoke('transcript-start', info),
+  recordTranscript: (segments) => ipcRenderer.send('transcript-record', segments),
+  endTranscriptSession: () => ipcRenderer.send('transcript-end'),
+  searchTranscripts: (options) => ipcRenderer.invoke('transcript-search', options),
+  getTranscriptContext: (options) => ipcRenderer.invoke('transcript-context', options),
+
   // Listen for subtitle updates (used by overlay window)
   onSubtitleUpdate: (callback) => {
     ipcRenderer.on('subtitle-update', (event, text) => callback(text));
@@ -0,0 +1,139 @@
+// Server selection for the capture pipeline. Probes each configured server's
+// /health endpoint (server_health.py) on a timer and picks the one with the
+// lowest cost: probe round-trip time plus a penalty for how busy its
+// inference workers are. Servers that are full, draining or unreachable are
+// skipped; servers without /health are used only when nothing better is up.
+
+const http = require('http');
+const https = require('https');
+
+const PROBE_INTERVAL_MS = 5000;
+const PROBE_TIMEOUT_MS = 2000;
+
+// One fully busy server (load 1.0) costs as much as this much extra latency
+const LOAD_PENALTY_MS = 500;
+
+// Cost of a server that answers but has no /health (older servers)
+const UNKNOWN_LOAD_PENALTY_MS = 1000;
+
+function healthUrl(serverUrl) {
+  const url = new URL(serverUrl);
+  url.protocol = url.protocol === 'wss:' ? 'https:' : 'http:';
+  url.pathname = '/health';
+  url.search = '';
+  return url;
+}
+
+function probe(serverUrl) {
+  return new Promise((resolve) => {
+    const url = healthUrl(serverUrl);
+    const started = performance.now();
+    const client = url.protocol === 'https:' ? https : http;
+    const request = client.get(url, { timeout: PROBE_TIMEOUT_MS }, (response) => {
+      let body = '';
+      response.setEncoding('utf8');
+      response.on('data', (chunk) => { body += chunk; });
+      response.on('end', () => {
+        const rttMs = Math.round(performance.now() - started);
+        if (response.statusCode !== 200) {
+          resolve({ status: 'unknown', rttMs });
+          return;
+        }
+        try {
+          const health = JSON.parse(body);
+          resolve({
+            status: health.status,
+            rttMs,
+            load: health.load,
+            sessions: health.sessions,
+            maxSessions: health.max_sessions,
+            rtf: health.rtf,
+            maxLagMs: health.max_lag_ms,
+            model: health.model,
+          });
+        } catch (error) {
+          resolve({ status: 'unknown', rttMs });
+        }
+      });
+    });
+    request.on('timeout', () => request.destroy(new Error('probe timed out')));
+    request.on('error', () => resolve({ status: 'down' }));
+  });
+}
+
+class ServerPool {
+  // onStatus(list) is called after every probe round
+  constructor(onStatus) {
+    this.onStatus = onStatus;
+    this.servers = new Map(); // url -> last probe result
+    this.timer = null;
+  }
+
+  setServers(urls) {
+    const previous = this.servers;
+    this.servers = new Map(urls.map((url) => [url, previous.get(url) || { status: 'pending' }]));
+    clearInterval(this.timer);
+    this.timer = null;
+    if (this.servers.size > 0) {
+      this.probeAll();
+      this.timer = setInterval(() => this.probeAll(), PROBE_INTERVAL_MS);
+    }
+  }
+
+  async probeAll() {
+    const urls = [...this.servers.keys()];
+    const results = await Promise.all(urls.map(probe));
+    urls.forEach((url, i) => {
+      if (this.servers.has(url)) {
+        this.servers.set(url, results[i]);
+      }
+    });
+    this.onStatus(this.status());
+  }
+
+  cost(entry) {
+    if (entry.status === 'ok') {
+      return entry.rttMs + (entry.load || 0) * LOAD_PENALTY_MS;
+    }
+    if (entry.status === 'unknown') {
+      return entry.rttMs + UNKNOWN_LOAD_PENALTY_MS;
+    }
+    if (entry.status === 'pending') {
+      return Number.MAX_SAFE_INTEGER; // not probed yet: last resort, in list order
+    }
+    return Infinity;
+  }
+
+  // Cheapest usable server not in exclude, or null
+  pick(exclude = []) {
+    let best = null;
+    let bestCost = Infinity;
+    for (const [url, entry] of this.servers) {
+      const cost = this.cost(entry);
+      if (!exclude.includes(url) && cost < bestCost) {
+        best = url;
+        bestCost = cost;
+      }
+    }
+    return best;
+  }
+
+  // A connection failed: skip this server until its next successful probe
+  markDown(url) {
+    if (this.servers.has(url)) {
+      this.servers.set(url, { status: 'down' });
+      this.onStatus(this.status());
+    }
+  }
+
+  status() {
+    return [...this.servers].map(([url, entry]) => ({ url, ...entry }));
+  }
+
+  stop() {
+    clearInterval(this.timer);
+    this.timer = null;
+  }
+}
+
+module.exports = { ServerPool };
@@ -0,0 +1,13 @@
+// Types for stream-session.mjs, used by the WASM worker in src/
+export interface StreamSessionOptions {
+  transcribe: (samples: Float32Array, onPartial: (text: string) => void) => Promise<string>;
+  emit: (message: Record<string, unknown>) => void;
+  overlay: (text: string) => void;
+  backend: string;
+}
+
+export declare class StreamSession {
+  constructor(options: StreamSessionOptions);
+  push(samples: Float32Array): void;
+  close(): void;
+}
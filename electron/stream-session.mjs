@@ -0,0 +1,117 @@
+// Streaming windowing for the in-app engines, mirroring moonshine_server.py:
+// 1.5 s windows with 0.3 s of overlap. Results use the servers' message
+// shapes, so the settings UI treats an in-app engine like any server.
+//
+// Audio that arrives while a window is being transcribed is buffered. If the
+// engine falls behind by more than MAX_BACKLOG samples, the oldest audio is
+// dropped. Lag stays bounded, as with the servers' flow control.
+//
+// While a window decodes, its text so far goes to the overlay as it grows.
+
+const SAMPLE_RATE = 16000;
+const WINDOW_SAMPLES = 24000;
+const OVERLAP_SAMPLES = 4800;
+const MAX_BACKLOG = WINDOW_SAMPLES * 3;
+
+export class StreamSession {
+  // transcribe(samples, onPartial) -> Promise<string>, calling onPartial(text so
+  // far) as the text grows; emit(message) sends to the UI;
+  // overlay(text) sends straight to the overlay window
+  constructor({ transcribe, emit, overlay, backend }) {
+    this.transcribe = transcribe;
+    this.emit = emit;
+    this.overlay = overlay;
+    this.backend = backend;
+    this.chunks = [];
+    this.buffered = 0;
+    this.streamSamples = 0;
+    this.segmentId = 0;
+    this.busy = false;
+    this.closed = false;
+    this.stats = { windows: 0, audioMs: 0, inferenceMs: 0, droppedMs: 0 };
+  }
+
+  push(samples) {
+    if (this.closed) {
+      return;
+    }
+    this.chunks.push(samples);
+    this.buffered += samples.length;
+    this.streamSamples += samples.length;
+    while (this.buffered - this.chunks[0].length >= MAX_BACKLOG) {
+      const dropped = this.chunks.shift();
+      this.buffered -= dropped.length;
+      this.stats.droppedMs += (dropped.length * 1000) / SAMPLE_RATE;
+    }
+    this.pump();
+  }
+
+  close() {
+    this.closed = true;
+    this.chunks = [];
+    this.buffered = 0;
+  }
+
+  async pump() {
+    if (this.busy || this.closed || this.buffered < WINDOW_SAMPLES) {
+      return;
+    }
+    this.busy = true;
+    const window = concat(this.chunks, this.buffered);
+    const end = this.streamSamples / SAMPLE_RATE;
+    this.chunks = [window.subarray(window.length - OVERLAP_SAMPLES)];
+    this.buffered = OVERLAP_SAMPLES;
+
+    const started = performance.now();
+    let text = '';
+    try {
+      text = await this.transcribe(window, (partial) => {
+        if (!this.closed) {
+          this.overlay(partial);
+        }
+      });
+    } catch (error) {
+      console.error('Transcription error:', error);
+    }
+    const elapsed = performance.now() - started;
+    this.busy = false;
+    if (this.closed) {
+      return;
+    }
+
+    this.stats.windows++;
+    this.stats.audioMs += ((window.length - OVERLAP_SAMPLES) * 1000) / SAMPLE_RATE;
+    this.stats.inferenceMs += elapsed;
+    this.emit({
+      type: 'engine_stats',
+      backend: this.backend,
+      rtf: this.stats.inferenceMs / Math.max(this.stats.audioMs, 1),
+      window_ms: Math.round(elapsed),
+      queue_ms: Math.round((this.buffered * 1000) / SAMPLE_RATE),
+      dropped_ms: Math.round(this.stats.droppedMs),
+    });
+
+    if (text) {
+      const segment = {
+        id: this.segmentId++,
+        rev: 0,
+        text,
+        start: Math.round((end - window.length / SAMPLE_RATE) * 1000) / 1000,
+        end: Math.round(end * 1000) / 1000,
+      };
+      this.overlay(text);
+      this.emit({ type: 'TRANSCRIPTION', segments: [segment], backend: this.backend });
+    }
+    this.pump();
+  }
+}
+
+function concat(chunks, length) {
+  const out = new Float32Array(length);
+  let offset = 0;
+  for (const chunk of chunks) {
+    out.set(chunk, offset);
+    offset += chunk.length;
+  }
+  return out;
+}
@@ -0,0 +1,292 @@
+// Transcript history: every committed segment, persisted per capture session
+// and searchable across all of them. Each session is one JSON-lines file in
+// the app's data directory (a header line, then one line per segment or
+// revision; the latest revision of a segment id wins). The search index
+// lives in memory and is built from those files on first use, then updated
+// as segments commit.
+//
+// The index is inverted: term -> the segments containing it, in commit order,
+// with the term's word positions in each. A query is a list of clauses that
+// must all match, intersected smallest first:
+//   thursday          the word
+//   thur*             any word starting with "thur"
+//   "moved to thursday"  the words next to each other, in this order
+// Revised segments are superseded in place (tombstoned), so postings stay
+// append-only and sorted.
+
+const fs = require('fs');
+const path = require('path');
+
+const MAX_RESULTS = 50;
+const CONTEXT_SEGMENTS = 50;
+
+// Han, kana: one token per character, as the scripts have no spaces
+const TOKEN = /[\p{Script=Han}\p{Script=Hiragana}\p{Script=Katakana}]|[\p{L}\p{N}]+(?:'[\p{L}\p{N}]+)*/gu;
+
+function tokenize(text) {
+  const folded = text.toLowerCase().normalize('NFKD').replace(/\p{M}/gu, '');
+  return folded.match(TOKEN) ?? [];
+}
+
+// "quoted phrases", prefix* and plain words
+function parseQuery(query) {
+  const clauses = [];
+  for (const match of query.matchAll(/"([^"]*)"?|(\S+)/g)) {
+    if (match[1] !== undefined) {
+      const terms = tokenize(match[1]);
+      if (terms.length === 1) clauses.push({ term: terms[0] });
+      else if (terms.length > 1) clauses.push({ phrase: terms });
+    } else if (match[2].endsWith('*')) {
+      const terms = tokenize(match[2]);
+      terms.slice(0, -1).forEach((term) => clauses.push({ term }));
+      if (terms.length) clauses.push({ prefix: terms[terms.length - 1] });
+    } else {
+      // "don't-stop" is two words in the index, so a phrase here
+      const terms = tokenize(match[2]);
+      if (terms.length === 1) clauses.push({ term: terms[0] });
+      else if (terms.length > 1) clauses.push({ phrase: terms });
+    }
+  }
+  return clauses;
+}
+
+// Lowest index in a sorted array whose value is >= target
+function lowerBound(sorted, target) {
+  let lo = 0;
+  let hi = sorted.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (sorted[mid] < target) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+function intersect(a, b) {
+  const out = [];
+  let i = 0;
+  let j = 0;
+  while (i < a.length && j < b.length) {
+    if (a[i] === b[j]) {
+      out.push(a[i]);
+      i++;
+      j++;
+    } else if (a[i] < b[j]) i++;
+    else j++;
+  }
+  return out;
+}
+
+class TranscriptStore {
+  constructor(directory) {
+    this.directory = directory;
+    this.docs = []; // doc number -> segment, or null once revised
+    this.postings = new Map(); // term -> { docs: number[], positions: number[][] }
+    this.terms = []; // every term, sorted, for prefix ranges; rebuilt when a search finds it stale
+    this.termsStale = false;
+    this.latest = new Map(); // `${session}\n${id}` -> doc number
+    this.sessions = new Map(); // session id -> { info, docs: number[] }, docs in commit order
+    this.current = null;
+    this.writer = null;
+    this.loaded = null;
+  }
+
+  // Index every saved session, once
+  load() {
+    if (!this.loaded) {
+      this.loaded = this._load();
+    }
+    return this.loaded;
+  }
+
+  async _load() {
+    await fs.promises.mkdir(this.directory, { recursive: true });
+    const files = (await fs.promises.readdir(this.directory)).filter((f) => f.endsWith('.jsonl')).sort();
+    for (const file of files) {
+      const lines = (await fs.promises.readFile(path.join(this.directory, file), 'utf8')).split('\n');
+      let session = null;
+      for (const line of lines) {
+        if (!line) continue;
+        let entry;
+        try {
+          entry = JSON.parse(line);
+        } catch (error) {
+          continue; // a line cut short by a crash
+        }
+        if (entry.type === 'session') {
+          // The session being recorded is already indexed
+          if (this.sessions.has(entry.id)) break;
+          session = entry.id;
+          this.sessions.set(session, { info: entry, docs: [] });
+        } else if (session) {
+          this._add(session, entry);
+        }
+      }
+    }
+  }
+
+  // Recording starts at once; older sessions are indexed in the background
+  startSession(info) {
+    this.endSession();
+    fs.mkdirSync(this.directory, { recursive: true });
+    const startedAt = Date.now();
+    const id = new Date(startedAt).toISOString().replace(/[:.]/g, '-');
+    const header = { type: 'session', id, startedAt, ...info };
+    this.sessions.set(id, { info: header, docs: [] });
+    this.current = id;
+    this.writer = fs.createWriteStream(path.join(this.directory, `${id}.jsonl`), { flags: 'a' });
+    this.writer.write(`${JSON.stringify(header)}\n`);
+    this.load();
+    return id;
+  }
+
+  endSession() {
+    if (this.writer) {
+      this.writer.end();
+    }
+    this.writer = null;
+    this.current = null;
+  }
+
+  // Segments and revisions of the current session, as the server sent them
+  record(segments) {
+    if (!this.current) return;
+    const at = Date.now();
+    for (const segment of segments) {
+      if (!segment.text || !segment.text.trim()) continue;
+      const entry = { id: segment.id, rev: segment.rev ?? 0, text: segment.text.trim(), at };
+      if (segment.start !== undefined) entry.start = segment.start;
+      if (segment.end !== undefined) entry.end = segment.end;
+      if (this._add(this.current, entry)) {
+        this.writer.write(`${JSON.stringify(entry)}\n`);
+      }
+    }
+  }
+
+  // Returns false for a stale revision
+  _add(session, entry) {
+    const sessionEntry = this.sessions.get(session);
+    const key = `${session}\n${entry.id}`;
+    // id -1: plain text without an id, never revised
+    const doc = this.docs.length;
+    let slot = sessionEntry.docs.length;
+    if (entry.id !== -1 && this.latest.has(key)) {
+      const previous = this.latest.get(key);
+      if (this.docs[previous].rev >= entry.rev) return false;
+      // The revision takes the original's place (and times) in the session
+      const { slot: originalSlot, start, end } = this.docs[previous];
+      slot = originalSlot;
+      entry = { start, end, ...entry };
+      this.docs[previous] = null;
+    }
+    this.docs.push({ session, slot, ...entry });
+    sessionEntry.docs[slot] = doc;
+    if (entry.id !== -1) this.latest.set(key, doc);
+
+    tokenize(entry.text).forEach((term, position) => {
+      let posting = this.postings.get(term);
+      if (!posting) {
+        posting = { docs: [], positions: [] };
+        this.postings.set(term, posting);
+        this.termsStale = true;
+      }
+      const last = posting.docs.length - 1;
+      if (posting.docs[last] === doc) {
+        posting.positions[last].push(position);
+      } else {
+        posting.docs.push(doc);
+        posting.positions.push([position]);
+      }
+    });
+    return true;
+  }
+
+  _termDocs(term) {
+    return this.postings.get(term)?.docs ?? [];
+  }
+
+  _prefixDocs(prefix) {
+    if (this.termsStale) {
+      this.terms = [...this.postings.keys()].sort();
+      this.termsStale = false;
+    }
+    const docs = new Set();
+    for (let i = lowerBound(this.terms, prefix); i < this.terms.length && this.terms[i].startsWith(prefix); i++) {
+      for (const doc of this.postings.get(this.terms[i]).docs) docs.add(doc);
+    }
+    return [...docs].sort((a, b) => a - b);
+  }
+
+  _positions(term, doc) {
+    const posting = this.postings.get(term);
+    return posting.positions[lowerBound(posting.docs, doc)];
+  }
+
+  _phraseDocs(terms) {
+    const docs = terms.map((term) => this._termDocs(term)).sort((a, b) => a.length - b.length).reduce(intersect);
+    return docs.filter((doc) => {
+      const following = terms.slice(1).map((term) => this._positions(term, doc));
+      return this._positions(terms[0], doc).some((start) => following.every((list, k) => list.includes(start + k + 1)));
+    });
+  }
+
+  _clauseDocs(clause) {
+    if (clause.term) return this._termDocs(clause.term);
+    if (clause.phrase) return this._phraseDocs(clause.phrase);
+    return this._prefixDocs(clause.prefix);
+  }
+
+  // Most recent first; times are milliseconds since the epoch (at) and into the session (offsetMs)
+  async search({ query, session = null, limit = MAX_RESULTS }) {
+    await this.load();
+    const started = performance.now();
+    const clauses = parseQuery(query ?? '');
+    if (!clauses.length) return { results: [], total: 0, tookMs: 0 };
+
+    const lists = clauses.map((clause) => this._clauseDocs(clause)).sort((a, b) => a.length - b.length);
+    let docs = lists.reduce(intersect);
+    docs = docs.filter((doc) => this.docs[doc] && (!session || this.docs[doc].session === session));
+    // Sessions may be indexed out of order (the current one before older ones)
+    const results = docs
+      .map((doc) => [this.sessions.get(this.docs[doc].session).info.startedAt, this.docs[doc].slot, doc])
+      .sort((a, b) => b[0] - a[0] || b[1] - a[1])
+      .slice(0, limit)
+      .map(([, , doc]) => this._result(doc));
+    return { results, total: docs.length, tookMs: Math.round((performance.now() - started) * 100) / 100 };
+  }
+
+  _result(doc) {
+    const { session, id, text, start, end, at } = this.docs[doc];
+    const startedAt = this.sessions.get(session).info.startedAt;
+    // Server stream time when there is one, else when it arrived
+    const offsetMs = start != null ? Math.round(start * 1000) : at - startedAt;
+    return {
+      session,
+      id,
+      doc,
+      text,
+      at,
+      offsetMs,
+      endMs: end != null ? Math.round(end * 1000) : null,
+    };
+  }
+
+  // The segments around one search hit, for jumping to it
+  async context({ session, doc, radius = CONTEXT_SEGMENTS }) {
+    await this.load();
+    const entry = this.sessions.get(session);
+    if (!entry) return null;
+    const slot = this.docs[doc]?.slot ?? entry.docs.length - 1;
+    return {
+      session: entry.info,
+      segments: entry.docs.slice(Math.max(0, slot - radius), slot + radius + 1).map((d) => this._result(d)),
+    };
+  }
+
+  async listSessions() {
+    await this.load();
+    return [...this.sessions.values()].map(({ info, docs }) => ({ ...info, segments: docs.length }));
+  }
+}
+
+module.exports = { TranscriptStore, tokenize, parseQuery };
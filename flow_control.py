@@ -0,0 +1,110 @@
+"""
+Credit-based flow control for the SubtitlesForAll WebSocket servers.
+
+The client may only have a bounded number of audio frames outstanding. The
+server advertises the window in its SERVER_READY message and returns credit
+as its transcription loop actually consumes frames:
+
+    server -> client  {"message": "SERVER_READY", ...,
+                       "flow_control": {"credits": 48, "unit": "frames"}}
+    server -> client  {"type": "credit", "granted": 148, "consumed": 100,
+                       "queue_depth": 3, "queue_ms": 256}
+
+``granted`` and ``consumed`` are cumulative frame counts, so a client may send
+frame number ``n`` (1-based) only while ``n <= granted``. Frames the client
+cannot send are dropped on the client side, which keeps end-to-end lag bounded
+instead of letting audio pile up in socket buffers.
+
+Clients that ignore credits still work; the overrun is counted and logged.
+
+Credits only cover frames sent over the WebSocket. Datagram audio
+(datagram_transport.py) arrives in 20 ms frames, is real-time and lossy by
+design, and the client sends it without looking at credits, so it is
+queued with credited=False: it counts towards queue_ms, not the window.
+"""
+
+import asyncio
+import json
+from collections import deque
+
+import numpy as np
+
+# ~4 s of the 1365-sample (85 ms) WebSocket frames the clients send;
+# must exceed one transcription window
+DEFAULT_CREDIT_WINDOW = 48
+
+
+class AudioInbox:
+    """Per-client queue of received audio frames with credit accounting."""
+
+    def __init__(self, window: int = DEFAULT_CREDIT_WINDOW, sample_rate: int = 16000):
+        self.window = window
+        self.sample_rate = sample_rate
+        self.queue: asyncio.Queue = asyncio.Queue()
+        self.received = 0
+        self.consumed = 0
+        self.pending_samples = 0
+        self.overruns = 0
+        # Whether each queued frame used credit, in queue order
+        self.credited = deque()
+
+    @property
+    def granted(self) -> int:
+        return self.consumed + self.window
+
+    @property
+    def queue_depth(self) -> int:
+        """Frames received but not yet taken by the transcription loop."""
+        return len(self.credited)
+
+    @property
+    def queue_ms(self) -> int:
+        return int(self.pending_samples * 1000 / self.sample_rate)
+
+    def ready_fields(self) -> dict:
+        """Fields to merge into the SERVER_READY message."""
+        return {"flow_control": {"credits": self.window, "unit": "frames"}}
+
+    def put(self, frame: np.ndarray, credited: bool = True):
+        """Queue a frame received from the client (credited=False for datagram audio)."""
+        if credited:
+            self.received += 1
+            if self.received > self.granted:
+                self.overruns += 1
+        self.credited.append(credited)
+        self.pending_samples += len(frame)
+        self.queue.put_nowait(frame)
+
+    async def get_batch(self) -> list:
+        """Wait for at least one frame (or a wake()), then take everything that is queued."""
+        frames = [await self.queue.get()]
+        while not self.queue.empty():
+            frames.append(self.queue.get_nowait())
+        return self._take(frames)
+
+    def wake(self):
+        """Release a waiting get_batch, possibly with no frames (used when a session migrates)."""
+        self.queue.put_nowait(None)
+
+    def take_all(self) -> list:
+        """Take whatever is queued without waiting (used when a session migrates)."""
+        frames = []
+        while not self.queue.empty():
+            frames.append(self.queue.get_nowait())
+        return self._take(frames)
+
+    def _take(self, frames: list) -> list:
+        # wake() markers were never received from the client, so they use no credit
+        frames = [f for f in frames if f is not None]
+        self.consumed += sum(self.credited.popleft() for _ in frames)
+        self.pending_samples -= sum(len(f) for f in frames)
+        return frames
+
+    def credit_message(self) -> str:
+        return json.dumps({
+            "type": "credit",
+            "granted": self.granted,
+            "consumed": self.consumed,
+            "queue_depth": self.queue_depth,
+            "queue_ms": self.queue_ms,
+        })
@@ -0,0 +1,297 @@
+"""
+Heap accounting for the SubtitlesForAll WebSocket servers
+
+Shows which part of a server owns its memory. Served on the WebSocket port:
+
+    GET http://<server>/metrics
+
+    {"process": {"rss_mb": 412.0, "anon_mb": 380.2},
+     "python": {"traced_mb": 61.4, "peak_mb": 75.0},
+     "untracked_mb": 350.6,
+     "sessions": {"140234": {"audio": 96000, "inbox": 21840, "send_buffer": 0}},
+     "stages": {"model": {"bytes": 41200000, "blocks": 812, "growth_bytes_per_s": 0},
+                "buffers": {"bytes": 5400000, "blocks": 96, "growth_bytes_per_s": 1200}, ...}}
+
+``process`` and ``sessions`` are always reported. ``sessions`` holds the bytes
+each client's buffers hold right now: audio not yet transcribed, frames
+queued in its inbox, and the socket's unsent output.
+
+With --trace-alloc, every Python-level allocation is traced (tracemalloc;
+numpy reports its array buffers there too). Each live block is attributed to
+a pipeline stage by the innermost frame of its traceback that belongs to
+this repository or to a known library. ``growth_bytes_per_s`` is the net
+change per stage since the previous heap walk. Walks run on a worker thread,
+at most every 10 s (more frequent requests get the last one). A stage that keeps growing
+under steady load is a leak, and one with a large ``peak_mb`` - ``traced_mb``
+gap churns temporaries. Tracing slows allocation-heavy code by roughly 2x,
+so it is a diagnostic mode, not for production.
+
+ONNX Runtime allocates its weights and arenas natively, outside Python's
+allocator. ``untracked_mb`` (RSS minus traced Python memory) covers them,
+the interpreter itself and allocator fragmentation.
+
+    GET http://<server>/metrics/dump
+
+(from the server's own machine) writes the traced allocations, grouped by traceback and stage, to a text
+file, and the raw tracemalloc snapshot next to it (load it with
+tracemalloc.Snapshot.load to diff two dumps). The reply names both files.
+"""
+
+import ast
+import asyncio
+import json
+import os
+import tempfile
+import time
+import tracemalloc
+from http import HTTPStatus
+from pathlib import Path
+
+from websockets.datastructures import Headers
+from websockets.http11 import Response
+
+from session_migration import is_loopback
+
+METRICS_PATH = "/metrics"
+DUMP_PATH = "/metrics/dump"
+DEFAULT_FRAMES = 16
+STAGE_CACHE_SECONDS = 10.0  # a snapshot walks the whole heap; reuse it for a while
+REPO = Path(__file__).resolve().parent
+
+# Repository code -> stage. Keys are module, module.function or
+# module.Class.method; nested functions count for their parent.
+STAGES = {
+    "moonshine_engine.encode": "encode",
+    "moonshine_engine.encode_batch": "encode",
+    "moonshine_engine.decode": "decode",
+    "moonshine_engine.decode_batch": "decode",
+    "moonshine_engine.specialize": "model",
+    "moonshine_engine": "pipeline",
+    "moonshine_server.MoonshineTranscriber.encode": "encode",
+    "moonshine_server.MoonshineTranscriber.decode": "decode",
+    "moonshine_server.MoonshineTranscriber.transcribe_batch": "decode",
+    "moonshine_server.MoonshineTranscriber": "model",
+    "moonshine_server.MoonshineWebSocketServer.process_audio": "buffers",
+    "moonshine_server.MoonshineWebSocketServer.send_results": "results",
+    "moonshine_server": "session",
+    "run_server.WebSocketServer.handle_client": "buffers",
+    "run_server.WhisperTranscriber": "whisper_request",
+    "run_server.pcm16": "whisper_request",
+    "run_server.pcm16_wav": "whisper_request",
+    "run_server": "session",
+    "detokenizer": "decode",
+    "flow_control": "inbox",
+    "datagram_transport": "datagram",
+    "caption_hub": "captions",
+    "session_migration": "migration",
+    "model_cascade": "cascade",
+    "shadow_eval": "shadow",
+    "heap_accounting": "accounting",
+}
+# Third-party packages whose own allocations are a stage of their own
+LIBRARIES = {
+    "websockets": "websockets",
+    "onnxruntime": "model",
+    "moonshine_onnx": "model",
+    "tokenizers": "model",
+}
+
+
+def process_memory() -> dict:
+    """RSS and anonymous memory from /proc (Linux); empty elsewhere."""
+    metrics = {}
+    try:
+        for line in Path("/proc/self/status").read_text().splitlines():
+            key, _, value = line.partition(":")
+            if key in ("VmRSS", "RssAnon"):
+                metrics["rss_mb" if key == "VmRSS" else "anon_mb"] = round(int(value.split()[0]) / 1024, 1)
+    except OSError:
+        pass
+    return metrics
+
+
+def session_bytes(session: dict, inbox, websocket) -> dict:
+    """Bytes one client's buffers hold right now."""
+    audio = session.get("audio")
+    if isinstance(audio, list):
+        audio_bytes = sum(chunk.nbytes for chunk in audio)
+    else:
+        audio_bytes = getattr(audio, "nbytes", 0)
+    transport = getattr(websocket, "transport", None)
+    return {
+        "audio": audio_bytes,
+        "inbox": inbox.pending_samples * 4,  # float32 frames not yet taken
+        "send_buffer": transport.get_write_buffer_size() if transport else 0,
+    }
+
+
+class _FunctionIndex:
+    """Maps (file, line) in this repository to module.Class.function names."""
+
+    def __init__(self):
+        self.spans = {}  # filename -> [(first line, last line, qualname)], None outside the repo
+
+    def name(self, filename: str, lineno: int):
+        if filename not in self.spans:
+            path = Path(filename)
+            self.spans[filename] = self._index(path) if path.parent == REPO and path.suffix == ".py" else None
+        spans = self.spans[filename]
+        if spans is None:
+            return None
+        best = None
+        for start, end, qualname in spans:
+            if start <= lineno <= end and (best is None or start >= best[0]):
+                best = (start, qualname)
+        module = os.path.basename(filename)[:-3]
+        return f"{module}.{best[1]}" if best else module
+
+    @staticmethod
+    def _index(path: Path) -> list:
+        spans = []
+
+        def visit(node, prefix):
+            for child in ast.iter_child_nodes(node):
+                if isinstance(child, (ast.FunctionDef, ast.AsyncFunctionDef, ast.ClassDef)):
+                    name = f"{prefix}{child.name}"
+                    if not isinstance(child, ast.ClassDef):
+                        spans.append((child.lineno, child.end_lineno, name))
+                    visit(child, f"{name}.")
+
+        try:
+            visit(ast.parse(path.read_text()), "")
+        except (OSError, SyntaxError):
+            pass
+        return spans
+
+
+class HeapAccounting:
+    """Per-session buffer sizes, and with tracing on, live Python heap per stage."""
+
+    def __init__(self, trace: bool = False, frames: int = DEFAULT_FRAMES, dump_dir: str = None):
+        self.trace = trace
+        self.dump_dir = Path(dump_dir or tempfile.gettempdir())
+        self.sessions = {}  # key -> callable returning {buffer: bytes}
+        self.functions = _FunctionIndex()
+        self.frame_stages = {}  # (filename, lineno) -> stage, None for frames that decide nothing
+        self.stage_cache = (0.0, {})
+        self.previous = (None, {})  # (time, {stage: bytes}) of the last heap walk
+        self.lock = asyncio.Lock()  # one heap walk at a time
+        if trace and not tracemalloc.is_tracing():
+            tracemalloc.start(frames)
+
+    def session_started(self, key, sizer):
+        self.sessions[key] = sizer
+
+    def session_ended(self, key):
+        self.sessions.pop(key, None)
+
+    def stage_of(self, traceback) -> str:
+        """Innermost frame that belongs to this repository or a known library."""
+        for frame in reversed(traceback):  # tracemalloc lists the oldest frame first
+            key = (frame.filename, frame.lineno)
+            if key not in self.frame_stages:
+                self.frame_stages[key] = self._frame_stage(*key)
+            if self.frame_stages[key]:
+                return self.frame_stages[key]
+        return "other"
+
+    def _frame_stage(self, filename: str, lineno: int):
+        name = self.functions.name(filename, lineno)
+        if name:
+            parts = name.split(".")
+            for n in range(len(parts), 0, -1):
+                stage = STAGES.get(".".join(parts[:n]))
+                if stage:
+                    return stage
+            return parts[0]
+        if "site-packages" in filename:
+            package = filename.split("site-packages", 1)[1].strip("/\\").split("/")[0].split("\\")[0]
+            return LIBRARIES.get(package)
+        if filename.startswith("<frozen importlib"):
+            return "imports"
+        return None
+
+    def stages(self) -> dict:
+        """{stage: {"bytes", "blocks", "growth_bytes_per_s"}} from a fresh or recent heap snapshot."""
+        taken, cached = self.stage_cache
+        if time.monotonic() - taken < STAGE_CACHE_SECONDS:
+            return cached
+        totals = {}
+        for stat in tracemalloc.take_snapshot().statistics("traceback"):
+            entry = totals.setdefault(self.stage_of(stat.traceback), {"bytes": 0, "blocks": 0})
+            entry["bytes"] += stat.size
+            entry["blocks"] += stat.count
+        now = time.monotonic()
+        then, before = self.previous
+        for stage, entry in totals.items():
+            entry["growth_bytes_per_s"] = round((entry["bytes"] - before.get(stage, 0)) / (now - then)) if then else None
+        self.previous = (now, {stage: entry["bytes"] for stage, entry in totals.items()})
+        totals = dict(sorted(totals.items(), key=lambda item: -item[1]["bytes"]))
+        self.stage_cache = (now, totals)
+        return totals
+
+    def snapshot(self) -> dict:
+        return {
+            "process": process_memory(),
+            "sessions": {str(id(key)): sizer() for key, sizer in list(self.sessions.items())},
+        }
+
+    def heap(self, process: dict) -> dict:
+        """Traced totals and per-stage bytes; seconds of work on a large heap."""
+        report = {}
+        current, peak = tracemalloc.get_traced_memory()
+        report["python"] = {"traced_mb": round(current / 2**20, 1), "peak_mb": round(peak / 2**20, 1)}
+        if "rss_mb" in process:
+            report["untracked_mb"] = round(process["rss_mb"] - current / 2**20, 1)
+        report["stages"] = self.stages()
+        return report
+
+    async def report(self) -> dict:
+        report = self.snapshot()
+        if self.trace:
+            # Walking the traced heap takes a while; audio keeps flowing meanwhile
+            async with self.lock:
+                report.update(await asyncio.get_running_loop().run_in_executor(None, self.heap, report["process"]))
+        return report
+
+    def dump(self) -> dict:
+        """Write the traced heap grouped by traceback, and the raw snapshot; returns the paths."""
+        snapshot = tracemalloc.take_snapshot()
+        stamp = time.strftime("%Y%m%d-%H%M%S")
+        base = self.dump_dir / f"heap-{os.getpid()}-{stamp}"
+        snapshot.dump(f"{base}.tracemalloc")
+        lines = []
+        for stat in snapshot.statistics("traceback")[:200]:
+            lines.append(f"[{self.stage_of(stat.traceback)}] {stat.size / 1024:.1f} KiB in {stat.count} blocks")
+            lines.extend(f"    {line}" for line in stat.traceback.format(limit=8, most_recent_first=True))
+        Path(f"{base}.txt").write_text("\n".join(lines) + "\n")
+        print(f"Heap dump written to {base}.txt")
+        return {"text": f"{base}.txt", "snapshot": f"{base}.tracemalloc"}
+
+    def process_request(self, connection, request):
+        """websockets hook: GET /metrics and /metrics/dump."""
+        path = request.path.split("?", 1)[0]
+        if path == METRICS_PATH:
+            return self._respond(self.report())
+        if path == DUMP_PATH:
+            # Writes files on the server, so only from this machine
+            if not is_loopback(connection.remote_address[0]):
+                return connection.respond(HTTPStatus.FORBIDDEN, "Forbidden\n")
+            if not self.trace:
+                return connection.respond(HTTPStatus.CONFLICT, "Start the server with --trace-alloc\n")
+            return self._respond(self._dump())
+        return None
+
+    async def _dump(self) -> dict:
+        async with self.lock:
+            return await asyncio.get_running_loop().run_in_executor(None, self.dump)
+
+    @staticmethod
+    async def _respond(pending) -> Response:
+        data = json.dumps(await pending).encode()
+        headers = Headers([
+            ("Content-Type", "application/json"),
+            ("Content-Length", str(len(data))),
+            ("Cache-Control", "no-cache"),
+        ])
+        return Response(HTTPStatus.OK.value, HTTPStatus.OK.phrase, headers, data)
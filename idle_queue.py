@@ -0,0 +1,67 @@
+"""
+Idle-gated background work for the SubtitlesForAll servers
+
+The model cascade (model_cascade.py) and shadow evaluation (shadow_eval.py)
+both decode extra windows that no client is waiting on. They share this
+queue: it is bounded (the oldest job is dropped first), jobs older than
+``max_age`` seconds are skipped, and a job only starts while no live decode
+is in flight. The server brackets every live decode with live_started() and
+live_finished().
+
+The gate is checked when a job starts; a job already running is not
+interrupted. A live window that arrives meanwhile waits for at most one
+background decode, because the next job waits for the live path again.
+"""
+
+import asyncio
+import time
+from collections import deque
+
+
+class IdleGatedQueue:
+    """Bounded job queue that hands out jobs only while the live path is idle."""
+
+    def __init__(self, max_pending: int, max_age: float, stats: dict):
+        self.max_age = max_age
+        # "dropped" and "stale" are counted in the owner's stats
+        self.stats = stats
+        self.pending = deque(maxlen=max_pending)  # (queued at, job), oldest first
+        self.wakeup = asyncio.Event()
+        self.live_in_flight = 0
+        self.live_idle = asyncio.Event()
+        self.live_idle.set()
+
+    def live_started(self):
+        self.live_in_flight += 1
+        self.live_idle.clear()
+
+    def live_finished(self):
+        self.live_in_flight -= 1
+        if self.live_in_flight == 0:
+            self.live_idle.set()
+
+    def push(self, job):
+        if len(self.pending) == self.pending.maxlen:
+            self.stats["dropped"] += 1
+        self.pending.append((time.monotonic(), job))
+        self.wakeup.set()
+
+    def discard(self, drop):
+        """Forget the queued jobs for which drop(job) is true."""
+        kept = [entry for entry in self.pending if not drop(entry[1])]
+        self.pending.clear()
+        self.pending.extend(kept)
+
+    async def jobs(self):
+        """Yield jobs oldest first, each once the live path is idle; runs forever."""
+        while True:
+            await self.wakeup.wait()
+            self.wakeup.clear()
+            while self.pending:
+                # Live traffic first, checked again before every job
+                await self.live_idle.wait()
+                queued_at, job = self.pending.popleft()
+                if time.monotonic() - queued_at > self.max_age:
+                    self.stats["stale"] += 1
+                    continue
+                yield job
@@ -0,0 +1,333 @@
+"""
+Per-application audio capture for Linux (PipeWire / PulseAudio)
+
+Taps a single application's playback stream with parec and streams it as
+16 kHz mono float32 straight to a SubtitlesForAll server. Nothing goes through
+Chromium's media stack, and no video track is needed. The sound server does
+the resampling and downmix.
+
+Usage:
+    python linux_capture.py list
+    python linux_capture.py capture --sink-input 42 --server ws://localhost:9091
+    python linux_capture.py capture --null-sink --server ws://localhost:9091
+
+`list` prints the playback streams as JSON. `capture` writes every server
+message to stdout as one JSON line and forwards JSON config lines read from
+stdin to the server. This is how the Electron main process drives it.
+
+Testing against a null sink (no real application needed):
+
+    python linux_capture.py capture --null-sink --server ws://localhost:9091
+    paplay -d sfa_capture_test speech.wav      # in another terminal
+
+Requirements:
+    pactl and parec (pulseaudio-utils; also provided by pipewire-pulse)
+"""
+
+import argparse
+import asyncio
+import json
+import re
+import subprocess
+import sys
+import threading
+from collections import deque
+
+try:
+    import websockets
+except ImportError:
+    print("Please install required packages: pip install websockets")
+    sys.exit(1)
+
+SAMPLE_RATE = 16000
+FRAME_SAMPLES = 1365  # ~85 ms, the frame size the Electron client sends
+NULL_SINK_NAME = "sfa_capture_test"
+# Frames held while no server is ready (~2 s); older ones are dropped
+MAX_RESUME_FRAMES = 24
+# With every server tried, wait this long and try them all again
+FAILOVER_RETRY = 0.5
+MAX_FAILOVER_ROUNDS = 6
+
+
+def list_streams() -> list:
+    """Return the current playback streams (PulseAudio sink inputs)."""
+    try:
+        result = subprocess.run(["pactl", "-f", "json", "list", "sink-inputs"],
+                                capture_output=True, text=True, check=True)
+        entries = [(s["index"], s.get("properties", {})) for s in json.loads(result.stdout)]
+    except (subprocess.CalledProcessError, json.JSONDecodeError):
+        # pactl before 16.0 has no JSON output
+        result = subprocess.run(["pactl", "list", "sink-inputs"],
+                                capture_output=True, text=True, check=True)
+        entries = _parse_sink_inputs(result.stdout)
+
+    return [{
+        "index": index,
+        "application": props.get("application.name", ""),
+        "media": props.get("media.name", ""),
+        "binary": props.get("application.process.binary", ""),
+        "pid": props.get("application.process.id"),
+    } for index, props in entries]
+
+
+def _parse_sink_inputs(text: str) -> list:
+    entries = []
+    for line in text.splitlines():
+        header = re.match(r"^Sink Input #(\d+)", line)
+        prop = re.match(r'^\s+([\w.]+) = "(.*)"$', line)
+        if header:
+            entries.append((int(header.group(1)), {}))
+        elif prop and entries:
+            entries[-1][1][prop.group(1)] = prop.group(2)
+    return entries
+
+
+def load_null_sink() -> int:
+    """Create a null sink for testing and return its module id."""
+    result = subprocess.run(
+        ["pactl", "load-module", "module-null-sink", f"sink_name={NULL_SINK_NAME}",
+         f"sink_properties=device.description={NULL_SINK_NAME}"],
+        capture_output=True, text=True, check=True)
+    return int(result.stdout.strip())
+
+
+def parec_command(sink_input: int = None, device: str = None) -> list:
+    cmd = ["parec", "--raw", "--format=float32le", f"--rate={SAMPLE_RATE}",
+           "--channels=1", "--latency-msec=20"]
+    if sink_input is not None:
+        cmd.append(f"--monitor-stream={sink_input}")
+    if device:
+        cmd.append(f"--device={device}")
+    return cmd
+
+
+def emit(message: dict):
+    print(json.dumps(message), flush=True)
+
+
+async def stream_to_server(cmd: list, server: str, config: dict, ask_server: bool = False):
+    """Pump parec output to the server, honouring its flow-control credit.
+
+    When the server moves the session to a peer ("migrate", see
+    session_migration.py) the recorder keeps running and the stream continues
+    on the peer with the resume token. When the connection drops, the helper
+    fails over the way the capture window does: with ask_server it asks the
+    parent process for the next server ({"type": "pick_server"} on stdout,
+    answered by {"type": "server_picked", "url": ...} on stdin), otherwise it
+    retries its one server. Frames captured in between are held back and sent
+    once the new server is ready, and segment ids are offset so they stay
+    unique across servers.
+    """
+    recorder = await asyncio.create_subprocess_exec(*cmd, stdout=asyncio.subprocess.PIPE)
+    stats = {"sent": 0, "dropped": 0, "granted": None}
+    # id_offset is added to the current server's segment ids
+    state = {"config": config, "migrate": None, "websocket": None, "id_offset": 0, "next_id": 0}
+    pending = deque()
+
+    # Daemon reader thread, so a silent stdin never blocks shutdown; it
+    # outlives each connection so a migration does not lose config lines
+    loop = asyncio.get_running_loop()
+    lines = asyncio.Queue()
+    picks = asyncio.Queue()
+
+    def read_stdin():
+        for line in sys.stdin:
+            queue = picks if '"server_picked"' in line else lines
+            loop.call_soon_threadsafe(queue.put_nowait, line)
+
+    threading.Thread(target=read_stdin, daemon=True).start()
+
+    async def send(websocket, data: bytes) -> bool:
+        """False if the connection is gone (the frame is not sent)."""
+        if stats["granted"] is not None and stats["sent"] >= stats["granted"]:
+            stats["dropped"] += 1
+            return True
+        try:
+            await websocket.send(data)
+        except websockets.exceptions.ConnectionClosed:
+            state["websocket"] = None
+            return False
+        stats["sent"] += 1
+        return True
+
+    def hold(data: bytes):
+        pending.append(data)
+        if len(pending) > MAX_RESUME_FRAMES:
+            pending.popleft()
+            stats["dropped"] += 1
+
+    # Runs for the whole capture, across connections
+    async def pump_audio():
+        frame_bytes = FRAME_SAMPLES * 4
+        while True:
+            try:
+                data = await recorder.stdout.readexactly(frame_bytes)
+            except asyncio.IncompleteReadError:
+                return
+            websocket = state["websocket"]
+            if websocket is None or not await send(websocket, data):
+                hold(data)
+
+    def renumber(segments: list) -> list:
+        for segment in segments:
+            segment["id"] += state["id_offset"]
+            state["next_id"] = max(state["next_id"], segment["id"] + 1)
+        return segments
+
+    async def pick_server(exclude: list, failed: str):
+        if not ask_server:
+            return None if server in exclude else server
+        emit({"type": "pick_server", "exclude": exclude, "failed": failed})
+        return json.loads(await picks.get()).get("url")
+
+    async def serve(url: str, first_config: dict):
+        """One connection; returns once it closes."""
+        async with websockets.connect(url, max_size=10 * 1024 * 1024) as websocket:
+            ready = json.loads(await websocket.recv())
+            stats["sent"] = 0
+            stats["granted"] = ready.get("flow_control", {}).get("credits")
+            emit(ready)
+            emit({"type": "server", "url": url})
+            await websocket.send(json.dumps(first_config))
+            # Audio captured while (re)connecting goes first, in order
+            while pending:
+                data = pending.popleft()
+                if not await send(websocket, data):
+                    pending.appendleft(data)
+                    break
+            else:
+                state["websocket"] = websocket
+
+            async def pump_results():
+                try:
+                    await results()
+                except websockets.exceptions.ConnectionClosed:
+                    pass
+
+            async def results():
+                async for message in websocket:
+                    data = json.loads(message)
+                    if data.get("type") == "credit":
+                        stats["granted"] = data["granted"]
+                        data["client_in_flight"] = stats["sent"] - data["consumed"]
+                        data["client_dropped"] = stats["dropped"]
+                    # A server answered the resume token; do not send it again
+                    if data.get("type") in ("resumed", "resume_failed"):
+                        state["config"].pop("resume", None)
+                    # The peer lost the session state: its ids start over
+                    if data.get("type") == "resume_failed":
+                        state["id_offset"] = state["next_id"]
+                    if data.get("segments"):
+                        data["segments"] = renumber(data["segments"])
+                    emit(data)
+                    if data.get("type") == "migrate":
+                        state["migrate"] = data
+                        return
+
+            async def pump_config():
+                while True:
+                    line = (await lines.get()).strip()
+                    if line:
+                        try:
+                            state["config"] = json.loads(line)
+                        except json.JSONDecodeError:
+                            pass
+                        try:
+                            await websocket.send(line)
+                        except websockets.exceptions.ConnectionClosed:
+                            # Sent with the config on the next connection
+                            return
+
+            tasks = [asyncio.create_task(t()) for t in (pump_results, pump_config)]
+            try:
+                # Stop when the recorder or the server goes away
+                await asyncio.wait([tasks[0], audio], return_when=asyncio.FIRST_COMPLETED)
+            finally:
+                state["websocket"] = None
+                for task in tasks:
+                    task.cancel()
+
+    audio = asyncio.create_task(pump_audio())
+    url, first_config = server, config
+    tried, rounds = [server], 0
+    try:
+        while True:
+            try:
+                await serve(url, first_config)
+                tried, rounds = [], 0
+            except (OSError, asyncio.TimeoutError, websockets.exceptions.WebSocketException) as e:
+                print(f"Connection to {url} failed: {e}", file=sys.stderr)
+            if audio.done():
+                break
+
+            migrate, state["migrate"] = state["migrate"], None
+            if migrate:
+                # Planned move: the peer holds the session
+                url = migrate["url"]
+                state["config"] = {**state["config"], "resume": migrate["resume"]}
+                first_config = state["config"]
+                continue
+
+            emit({"type": "failover", "from": url})
+            state["id_offset"] = state["next_id"]
+            url = await pick_server(tried, url)
+            while url is None:
+                if rounds >= MAX_FAILOVER_ROUNDS:
+                    emit({"type": "capture_ended", "error": "No transcription server available"})
+                    return
+                rounds += 1
+                tried = []
+                await asyncio.sleep(FAILOVER_RETRY)
+                url = await pick_server(tried, None)
+            tried.append(url)
+            # A resume token not yet answered goes along; the server says if it holds the session
+            first_config = state["config"]
+    finally:
+        audio.cancel()
+        if recorder.returncode is None:
+            recorder.terminate()
+            await recorder.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-application audio capture for Linux")
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("list", help="List playback streams as JSON")
+    capture = sub.add_parser("capture", help="Stream one application's audio to a server")
+    source = capture.add_mutually_exclusive_group(required=True)
+    source.add_argument("--sink-input", type=int, help="Sink input index from 'list'")
+    source.add_argument("--null-sink", action="store_true",
+                        help=f"Capture a temporary null sink ('{NULL_SINK_NAME}') for testing")
+    capture.add_argument("--server", default="ws://localhost:9091", help="Server WebSocket URL")
+    capture.add_argument("--config", default="{}", help="Initial JSON config message")
+    capture.add_argument("--ask-server", action="store_true",
+                         help="On a dropped connection, ask the parent process for the next server")
+
+    args = parser.parse_args()
+
+    if args.command == "list":
+        print(json.dumps(list_streams()))
+        return
+
+    config = json.loads(args.config)
+    # The helper always streams over the WebSocket
+    config["transport"] = "websocket"
+
+    null_sink_module = None
+    if args.null_sink:
+        null_sink_module = load_null_sink()
+        cmd = parec_command(device=f"{NULL_SINK_NAME}.monitor")
+    else:
+        cmd = parec_command(sink_input=args.sink_input)
+
+    try:
+        asyncio.run(stream_to_server(cmd, args.server, config, args.ask_server))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if null_sink_module is not None:
+            subprocess.run(["pactl", "unload-module", str(null_sink_module)])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,366 @@
+"""
+Load generator and soak test for the transcription servers
+
+Streams audio into run_server.py or moonshine_server.py from many concurrent
+simulated clients, at real-time pace and within their flow-control credit,
+as the app does. Caption latency is measured per segment: from sending the
+last sample a segment covers to receiving the segment.
+
+    run    a fixed number of sessions for --duration seconds; prints the
+           latency percentiles at the end
+    soak   sessions for hours, with reconnects and model switches. Server
+           memory, file descriptors, threads, latency and queue depth are
+           sampled every --sample-interval seconds. At the end, a trend is
+           fitted to each metric, and metrics that keep growing are flagged
+
+Usage:
+    python loadgen.py run --server ws://localhost:9091 --sessions 8 --duration 120 --audio speech.wav
+    python loadgen.py soak --server ws://localhost:9091 --sessions 4 --hours 12 \\
+        --models moonshine/tiny moonshine/base --server-pid 12345 --csv soak.csv
+    python loadgen.py soak --spawn "python moonshine_server.py --port 9391" \\
+        --server ws://localhost:9391 --hours 24
+
+Process metrics come from /proc (Linux), for the process given by
+--server-pid or started with --spawn. Queue depth and lag come from the
+server's credit messages and /health, session buffers and (with the
+server's --trace-alloc) the Python heap from /metrics. soak exits with status 1 if any
+metric drifts by more than --drift per hour after the --warmup period.
+"""
+
+import argparse
+import asyncio
+import bisect
+import csv
+import json
+import os
+import random
+import shlex
+import subprocess
+import sys
+import time
+import urllib.request
+import wave
+from pathlib import Path
+
+import numpy as np
+import websockets
+
+SAMPLE_RATE = 16000
+FRAME_SAMPLES = 1365  # the capture worklet's frame (~85 ms)
+FRAME_SECONDS = FRAME_SAMPLES / SAMPLE_RATE
+# Metrics checked for growth at the end of a soak
+TREND_METRICS = ("rss_mb", "anon_mb", "fds", "threads", "p95_ms", "queue_depth", "max_lag_ms",
+                 "session_kb", "traced_mb", "untracked_mb")
+
+
+def load_audio(path: str, seconds: float) -> np.ndarray:
+    """16 kHz mono audio from a WAV file (looped to at least ``seconds``), or low-level noise."""
+    if not path:
+        return (np.random.default_rng(0).standard_normal(int(SAMPLE_RATE * seconds)) * 0.01).astype(np.float32)
+    with wave.open(path, "rb") as wav:
+        if wav.getframerate() != SAMPLE_RATE or wav.getnchannels() != 1 or wav.getsampwidth() != 2:
+            sys.exit(f"{path}: expected 16 kHz mono 16-bit WAV")
+        audio = np.frombuffer(wav.readframes(wav.getnframes()), dtype=np.int16).astype(np.float32) / 32768.0
+    if len(audio) < SAMPLE_RATE * seconds:
+        audio = np.tile(audio, int(SAMPLE_RATE * seconds // max(len(audio), 1)) + 1)
+    return audio
+
+
+def percentile(values, q):
+    return round(float(np.percentile(values, q))) if values else None
+
+
+class Stats:
+    """Counters shared by all sessions; drained by each sample."""
+
+    def __init__(self):
+        self.latencies = []
+        self.queue_depths = []
+        self.totals = {"connects": 0, "failures": 0, "segments": 0, "sent": 0, "dropped": 0,
+                       "switches": 0, "migrations": 0}
+        self.last = dict(self.totals)
+
+    def take(self) -> dict:
+        """Latency/queue figures since the last call, and counter increments."""
+        latencies, self.latencies = self.latencies, []
+        depths, self.queue_depths = self.queue_depths, []
+        row = {key: value - self.last[key] for key, value in self.totals.items()}
+        self.last = dict(self.totals)
+        row.update({"p50_ms": percentile(latencies, 50), "p95_ms": percentile(latencies, 95),
+                    "p99_ms": percentile(latencies, 99), "queue_depth": max(depths, default=0)})
+        return row
+
+
+class Session:
+    """One simulated client: connect, stream, switch models, disconnect, repeat."""
+
+    def __init__(self, number: int, args, audio: np.ndarray, stats: Stats):
+        self.number = number
+        self.args = args
+        self.audio = audio
+        self.stats = stats
+        self.models = args.models or [None]
+        self.model_index = number % len(self.models)
+
+    def config(self) -> dict:
+        config = {"uid": f"loadgen_{self.number}", "language": self.args.language,
+                  "task": "transcribe", "use_vad": True}
+        if self.models[self.model_index]:
+            config["model"] = self.models[self.model_index]
+        return config
+
+    async def run(self, stop: asyncio.Event):
+        while not stop.is_set():
+            lifetime = random.uniform(self.args.session_min, self.args.session_max)
+            try:
+                await asyncio.wait_for(self.stream(stop), lifetime)
+            except asyncio.TimeoutError:
+                pass  # end of this session's lifetime: reconnect
+            except (OSError, websockets.WebSocketException) as e:
+                self.stats.totals["failures"] += 1
+                if self.args.verbose:
+                    print(f"[session {self.number}] {type(e).__name__}: {e}")
+            if not stop.is_set():
+                await asyncio.sleep(random.uniform(0.5, 2.0))
+
+    async def stream(self, stop: asyncio.Event):
+        async with websockets.connect(self.args.server, max_size=None, open_timeout=10) as ws:
+            self.stats.totals["connects"] += 1
+            await ws.send(json.dumps(self.config()))
+            # Flow control: frame n may be sent only while n <= granted
+            flow = {"enabled": False, "granted": 0}
+            sent_at = ([], [])  # (samples sent so far, time) per frame
+            receiver = asyncio.create_task(self.receive(ws, flow, sent_at))
+            try:
+                await self.send(ws, flow, sent_at, stop)
+            finally:
+                receiver.cancel()
+
+    async def send(self, ws, flow: dict, sent_at, stop: asyncio.Event):
+        offset = random.randrange(0, max(len(self.audio) - FRAME_SAMPLES, 1))
+        samples = 0
+        sent = 0
+        next_frame = time.monotonic()
+        next_switch = time.monotonic() + self.args.switch_every if self.args.switch_every else None
+        while not stop.is_set():
+            if offset + FRAME_SAMPLES > len(self.audio):
+                offset = 0
+            frame = self.audio[offset:offset + FRAME_SAMPLES]
+            offset += FRAME_SAMPLES
+            if flow["enabled"] and sent >= flow["granted"]:
+                self.stats.totals["dropped"] += 1
+            else:
+                await ws.send(frame.tobytes())
+                sent += 1
+                samples += FRAME_SAMPLES
+                sent_at[0].append(samples)
+                sent_at[1].append(time.monotonic())
+                self.stats.totals["sent"] += 1
+            if next_switch and time.monotonic() >= next_switch and len(self.models) > 1:
+                self.model_index = (self.model_index + 1) % len(self.models)
+                await ws.send(json.dumps(self.config()))
+                self.stats.totals["switches"] += 1
+                next_switch = time.monotonic() + self.args.switch_every
+            next_frame += FRAME_SECONDS
+            await asyncio.sleep(max(0.0, next_frame - time.monotonic()))
+
+    async def receive(self, ws, flow: dict, sent_at):
+        async for message in ws:
+            data = json.loads(message)
+            if data.get("flow_control"):
+                flow["enabled"] = True
+                flow["granted"] = data["flow_control"]["credits"]
+            if data.get("type") == "credit":
+                flow["granted"] = data["granted"]
+                self.stats.queue_depths.append(data.get("queue_depth", 0))
+            elif data.get("type") == "migrate":
+                self.stats.totals["migrations"] += 1
+            elif data.get("type") != "segment_revision":
+                now = time.monotonic()
+                for segment in data.get("segments") or []:
+                    # Server stream time counts the samples it received
+                    index = bisect.bisect_left(sent_at[0], int(segment["end"] * SAMPLE_RATE))
+                    if index < len(sent_at[1]):
+                        self.stats.latencies.append((now - sent_at[1][index]) * 1000)
+                    self.stats.totals["segments"] += 1
+
+
+def health_url(server: str, path: str = "/health") -> str:
+    return server.replace("wss://", "https://").replace("ws://", "http://").rstrip("/") + path
+
+
+def server_health(server: str, path: str = "/health", timeout: float = 2) -> dict:
+    try:
+        with urllib.request.urlopen(health_url(server, path), timeout=timeout) as response:
+            return json.loads(response.read())
+    except Exception:
+        return {}
+
+
+def process_metrics(pid: int) -> dict:
+    """RSS, anonymous memory, open file descriptors and threads from /proc."""
+    if not pid or not Path(f"/proc/{pid}").exists():
+        return {}
+    status = {}
+    for line in Path(f"/proc/{pid}/status").read_text().splitlines():
+        key, _, value = line.partition(":")
+        status[key] = value.split()
+    metrics = {"rss_mb": round(int(status["VmRSS"][0]) / 1024, 1), "threads": int(status["Threads"][0])}
+    if "RssAnon" in status:
+        metrics["anon_mb"] = round(int(status["RssAnon"][0]) / 1024, 1)
+    try:
+        metrics["fds"] = len(os.listdir(f"/proc/{pid}/fd"))
+    except OSError:
+        pass
+    return metrics
+
+
+def theil_sen(hours: list, values: list) -> float:
+    """Robust slope (per hour): the median of all pairwise slopes."""
+    if len(values) > 200:
+        step = len(values) / 200
+        picks = [int(i * step) for i in range(200)]
+        hours, values = [hours[i] for i in picks], [values[i] for i in picks]
+    slopes = [(values[j] - values[i]) / (hours[j] - hours[i])
+              for i in range(len(values)) for j in range(i + 1, len(values)) if hours[j] > hours[i]]
+    return float(np.median(slopes)) if slopes else 0.0
+
+
+def trends(rows: list, warmup_hours: float, drift: float) -> list:
+    """(metric, start, end, change per hour, flagged) for each sampled metric."""
+    report = []
+    rows = [r for r in rows if r["hours"] >= warmup_hours]
+    for metric in TREND_METRICS:
+        points = [(r["hours"], r[metric]) for r in rows if r.get(metric) is not None]
+        if len(points) < 5:
+            continue
+        hours, values = zip(*points)
+        slope = theil_sen(list(hours), list(values))
+        start = float(np.median(values[:max(len(values) // 10, 3)]))
+        relative = slope / start if start else (float("inf") if slope > 0 else 0.0)
+        # File descriptors and threads should not grow at all once warm
+        flagged = slope > 0 and (relative > drift or (metric in ("fds", "threads") and
+                                                      slope * (hours[-1] - hours[0]) >= 1))
+        report.append((metric, start, values[-1], relative, flagged))
+    return report
+
+
+async def run(args) -> int:
+    audio = load_audio(args.audio, 60)
+    stats = Stats()
+    stop = asyncio.Event()
+    sessions = [Session(n, args, audio, stats) for n in range(args.sessions)]
+    tasks = [asyncio.create_task(s.run(stop)) for s in sessions]
+    duration = args.hours * 3600 if args.command == "soak" else args.duration
+    started = time.monotonic()
+    rows = []
+    writer = None
+    csv_file = open(args.csv, "w", newline="") if args.csv else None
+
+    try:
+        while time.monotonic() - started < duration:
+            await asyncio.sleep(min(args.sample_interval, max(duration - (time.monotonic() - started), 0.1)))
+            row = {"hours": round((time.monotonic() - started) / 3600, 4), **stats.take()}
+            health = await asyncio.get_running_loop().run_in_executor(None, server_health, args.server)
+            row.update({"load": health.get("load"), "rtf": health.get("rtf"),
+                        "max_lag_ms": health.get("max_lag_ms"), "server_sessions": health.get("sessions")})
+            row.update(process_metrics(args.server_pid))
+            # heap_accounting.py: session buffers, and with --trace-alloc the traced heap,
+            # whose walk can take seconds
+            heap = await asyncio.get_running_loop().run_in_executor(None, server_health, args.server, "/metrics", 30)
+            if heap:
+                row["session_kb"] = round(sum(sum(s.values()) for s in heap["sessions"].values()) / 1024, 1)
+                row["traced_mb"] = heap.get("python", {}).get("traced_mb")
+                row["untracked_mb"] = heap.get("untracked_mb")
+            rows.append(row)
+            print(f"[{row['hours'] * 60:7.1f} min] p50 {row['p50_ms']} ms, p95 {row['p95_ms']} ms, "
+                  f"queue {row['queue_depth']}, lag {row['max_lag_ms']} ms, "
+                  f"rss {row.get('rss_mb', '-')} MB, fds {row.get('fds', '-')}, "
+                  f"{row['connects']} connects, {row['failures']} failures, {row['dropped']} dropped")
+            if csv_file:
+                if writer is None:
+                    writer = csv.DictWriter(csv_file, fieldnames=list(row), extrasaction="ignore")
+                    writer.writeheader()
+                writer.writerow(row)
+                csv_file.flush()
+    except asyncio.CancelledError:
+        pass
+    finally:
+        stop.set()
+        for task in tasks:
+            task.cancel()
+        await asyncio.gather(*tasks, return_exceptions=True)
+        if csv_file:
+            csv_file.close()
+
+    totals = stats.totals
+    print(f"\n{args.sessions} sessions, {(time.monotonic() - started) / 60:.1f} min: "
+          f"{totals['segments']} segments, {totals['connects']} connects, {totals['failures']} failures, "
+          f"{totals['switches']} model switches, {totals['dropped']} frames dropped of "
+          f"{totals['sent'] + totals['dropped']}")
+    if args.command == "run":
+        all_p95 = [r["p95_ms"] for r in rows if r["p95_ms"] is not None]
+        print(f"Caption latency p95 per interval: {all_p95}")
+        return 0
+
+    report = trends(rows, args.warmup, args.drift)
+    print(f"\nTrends after the first {args.warmup:g} h (flagged above {args.drift:.0%} per hour):")
+    for metric, start, end, relative, flagged in report:
+        print(f"  {metric:12} {start:10.1f} -> {end:<10} {relative:+8.2%}/h" + ("  GROWING" if flagged else ""))
+    return 1 if any(flagged for *_, flagged in report) else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load generator and soak test for the transcription servers")
+    sub = parser.add_subparsers(dest="command", required=True)
+    run_parser = sub.add_parser("run", help="Fixed load for a while, then latency percentiles")
+    run_parser.add_argument("--duration", type=float, default=120, help="Seconds")
+    soak_parser = sub.add_parser("soak", help="Hours of load with reconnects, model switches and drift tracking")
+    soak_parser.add_argument("--hours", type=float, default=12)
+    soak_parser.add_argument("--warmup", type=float, default=0.5, help="Hours ignored by the trend fit")
+    soak_parser.add_argument("--drift", type=float, default=0.02,
+                             help="Growth per hour (relative to the start) that flags a metric")
+    for p, interval, session_min, session_max, switch in ((run_parser, 5, 1e9, 1e9, 0),
+                                                          (soak_parser, 60, 60, 900, 300)):
+        p.add_argument("--server", default="ws://localhost:9091")
+        p.add_argument("--sessions", type=int, default=4, help="Concurrent simulated clients")
+        p.add_argument("--audio", default=None, help="16 kHz mono WAV to stream in a loop (default: noise)")
+        p.add_argument("--language", default=None)
+        p.add_argument("--models", nargs="*", default=None,
+                       help="Models the sessions request, rotated on each switch")
+        p.add_argument("--switch-every", type=float, default=switch,
+                       help="Seconds between model switches per session (0 = never)")
+        p.add_argument("--session-min", type=float, default=session_min,
+                       help="Shortest session before reconnecting, in seconds")
+        p.add_argument("--session-max", type=float, default=session_max,
+                       help="Longest session before reconnecting, in seconds")
+        p.add_argument("--sample-interval", type=float, default=interval, help="Seconds between samples")
+        p.add_argument("--server-pid", type=int, default=None, help="Server process to read /proc metrics from")
+        p.add_argument("--spawn", default=None, help="Start the server with this command (and stop it after)")
+        p.add_argument("--csv", default=None, help="Write every sample to this CSV file")
+        p.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+
+    server = None
+    if args.spawn:
+        server = subprocess.Popen(shlex.split(args.spawn))
+        args.server_pid = server.pid
+        deadline = time.monotonic() + 300
+        while not server_health(args.server) and time.monotonic() < deadline and server.poll() is None:
+            time.sleep(1)
+        if not server_health(args.server):
+            server.terminate()
+            sys.exit(f"Server did not come up at {health_url(args.server)}")
+    try:
+        code = asyncio.run(run(args))
+    except KeyboardInterrupt:
+        code = 130
+    finally:
+        if server:
+            server.terminate()
+            server.wait(timeout=30)
+    sys.exit(code)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+"""
+Confidence-based model cascade for SubtitlesForAll
+
+Every window is decoded by the fast model. Windows that the fast model was
+unsure about (low average log-probability, or an ambiguous no-speech score)
+are queued for a larger model. That queue (idle_queue.py) only starts a job
+while no fast-path decode is in flight, and the corrected text reaches the
+client as a segment revision:
+
+    {"type": "segment_revision", "model": "small",
+     "segments": [{"id": 7, "rev": 1, "text": ..., "start": ..., "end": ...}]}
+
+Corrections go stale quickly in live captions. The queue is bounded, the
+oldest jobs are dropped first, and jobs older than ``max_age`` seconds are
+skipped.
+"""
+
+from idle_queue import IdleGatedQueue
+
+DEFAULT_LOGPROB_THRESHOLD = -0.7
+DEFAULT_NO_SPEECH_THRESHOLD = 0.5
+DEFAULT_MAX_PENDING = 8
+DEFAULT_MAX_AGE = 10.0
+
+
+class ModelCascade:
+    """Low-priority re-decoding of low-confidence windows with a larger model."""
+
+    def __init__(self, transcriber, model_name: str,
+                 logprob_threshold: float = DEFAULT_LOGPROB_THRESHOLD,
+                 no_speech_threshold: float = DEFAULT_NO_SPEECH_THRESHOLD,
+                 max_pending: int = DEFAULT_MAX_PENDING,
+                 max_age: float = DEFAULT_MAX_AGE):
+        self.transcriber = transcriber
+        self.model_name = model_name
+        self.logprob_threshold = logprob_threshold
+        self.no_speech_threshold = no_speech_threshold
+        self.stats = {"escalated": 0, "revised": 0, "unchanged": 0, "dropped": 0, "stale": 0}
+        self.queue = IdleGatedQueue(max_pending, max_age, self.stats)
+
+    def needs_escalation(self, confidence: dict) -> bool:
+        avg_logprob = confidence.get("avg_logprob")
+        no_speech_prob = confidence.get("no_speech_prob")
+        if avg_logprob is not None and avg_logprob < self.logprob_threshold:
+            return True
+        return no_speech_prob is not None and no_speech_prob > self.no_speech_threshold
+
+    def submit(self, owner, audio, segment: dict, deliver, language: str = None, prompt: str = None):
+        """Queue a window for re-decoding; ``deliver(segment)`` sends the revision.
+
+        language and prompt are the ones the fast pass decoded with, so a
+        revision keeps the session's language and context.
+        """
+        self.queue.push((owner, audio, dict(segment), deliver, language, prompt))
+        self.stats["escalated"] += 1
+
+    def discard(self, owner):
+        """Forget the queued windows of a session that has ended."""
+        self.queue.discard(lambda job: job[0] is owner)
+
+    async def run(self):
+        """Worker loop; start once per server with asyncio.create_task."""
+        async for _owner, audio, segment, deliver, language, prompt in self.queue.jobs():
+            try:
+                text, _ = await self.transcriber.transcribe_with_confidence(audio, prompt, language)
+            except Exception as e:
+                print(f"Cascade transcription error: {e}")
+                continue
+            text = text.strip()
+            if not text or text == segment["text"]:
+                self.stats["unchanged"] += 1
+                continue
+            self.stats["revised"] += 1
+            segment.update(text=text, rev=segment["rev"] + 1)
+            try:
+                await deliver(segment)
+            except Exception:
+                # Client went away between decode and delivery
+                pass
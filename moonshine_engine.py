@@ -0,0 +1,555 @@
+"""
+Pipelined Moonshine inference for SubtitlesForAll
+
+Moonshine runs as two ONNX sessions: a wide, parallel encoder and a narrow,
+token-by-token decoder. Run back to back, cores sit idle while a window
+decodes. StagePipeline splits the two stages onto separate thread pools with a
+bounded queue between them, so the encoder can work on window N+1 while
+window N is still decoding:
+
+    audio -> [encoder pool] -> queue (depth) -> [decoder pool] -> text
+
+Results still come out in window order. When the queue is full, submit()
+waits. That holds back flow-control credit, so the client drops audio instead
+of building up lag.
+
+The stage split drives the model's ``encoder`` and ``decoder`` sessions the
+same way ``MoonshineOnnxModel.generate`` does. Models without those sessions
+(older moonshine-onnx releases) run ``generate`` whole in the decoder stage.
+
+Thread policy: the encoder and decoder sessions run on persistent intra-op
+thread pools, which all clients share. When the stages overlap, the threads
+(--threads, default one per CPU) are split between them instead of both
+taking every core: the encoder gets its own pool of ``encoder_threads``,
+which parks at once because it waits for the decoder between windows, and
+the decoder a pool of the rest. When they do not (batching, or
+--encoder-threads 0), encoder and decoder share one pool: ONNX Runtime's
+process-wide pool, created once at startup, which also outlives model
+switches. The decoder runs many small ops per token, and its workers either
+spin for a short while before parking ("hybrid", the ONNX Runtime default)
+or park at once ("park"). For 1-2 s windows the spin skips the wake-up
+latency of every op, at the cost of burning CPU while the pool waits.
+Python cannot turn spinning off in the process-wide pool, and once it
+exists no session can have a pool of its own, so "park" and the split keep
+per-session pools. bench_engine.py measures both policies, and the
+pipeline's throughput against running the stages back to back.
+
+Cross-session batching (WindowBatcher): with --batch-size above 1, windows
+from all sessions go to one shared batcher instead. It groups windows of
+similar length (buckets of ``bucket_ms``) and runs each group through one
+batched encoder call and one batched greedy decode. Shorter windows are
+zero-padded to the longest in the group, and the padding is masked out.
+Graphs exported without attention masks would let the padding change the
+output, so for those only windows of exactly the same length are batched
+(masks_padding). Small Moonshine models are
+bound by memory traffic and per-call overhead, not arithmetic, so a batch of
+N costs far less than N single calls. BatchPipeline keeps StagePipeline's
+per-session interface: ordered results and a bounded queue.
+
+Specialised sessions (specialize): the exported graphs keep the batch size
+and the decoder's step length symbolic. A streaming session always feeds one
+window and one token per step, so both can be pinned to 1 when the sessions
+are created. ONNX Runtime then knows every shape up front, so it can fold the
+shape arithmetic around attention and layer norm, fuse more of the graph, and
+prepack MatMul weights for the real sizes. The specialised sessions are only
+used if they reproduce the generic sessions' output on probe windows.
+"""
+
+import asyncio
+import copy
+import os
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+DEFAULT_PIPELINE_DEPTH = 2
+SPIN_POLICIES = ("hybrid", "park")
+DECODER_START_TOKEN = 1
+EOS_TOKEN = 2
+TOKENS_PER_SECOND = 6  # decode budget, as in moonshine-onnx
+
+
+def _spinning(options, allow: bool):
+    value = "1" if allow else "0"
+    options.add_session_config_entry("session.intra_op.allow_spinning", value)
+    options.add_session_config_entry("session.inter_op.allow_spinning", value)
+
+
+_global_pool_threads = None  # size of ONNX Runtime's process-wide intra-op pool, once created
+
+
+def global_pool(threads: int) -> int:
+    """Create ONNX Runtime's process-wide intra-op pool once; returns its size.
+
+    Once it exists, every session created in the process must use it.
+    """
+    global _global_pool_threads
+    if _global_pool_threads is None:
+        from onnxruntime.capi import _pybind_state
+        _pybind_state.set_global_thread_pool_sizes(threads, 1)
+        _global_pool_threads = threads
+    return _global_pool_threads
+
+
+class ThreadLayout:
+    """Intra-op threads of the encoder and decoder sessions.
+
+    encoder_threads > 0 gives the encoder its own pool of that many threads,
+    with spinning off, and the decoder its own pool of the remaining ones;
+    None takes half. With 0 (stages that never overlap), both sessions share
+    every thread: under the hybrid policy that is the process-wide pool,
+    set up here; under "park" each session keeps its own pool, since the
+    process-wide one always spins. shared=False keeps per-session pools
+    under hybrid too (for comparing the spin policies alone).
+
+    Sessions must be created with options(): once the process-wide pool
+    exists, ONNX Runtime refuses sessions with default options.
+    """
+
+    def __init__(self, threads: int = 0, spin: str = "hybrid", encoder_threads: int = 0, shared: bool = None):
+        self.threads = threads or os.cpu_count() or 1
+        self.spin = spin
+        if encoder_threads is None:
+            encoder_threads = self.threads // 2
+        # A split needs at least one thread on each side
+        self.encoder_threads = encoder_threads if 0 < encoder_threads < self.threads else 0
+        if shared is None:
+            shared = spin == "hybrid" and not self.encoder_threads
+        self.shared = shared or _global_pool_threads is not None
+        if self.shared:
+            if not shared:
+                print("  Sessions cannot have their own pools once the process-wide pool exists; using it")
+            self.threads = global_pool(self.threads)
+            self.encoder_threads = 0
+
+    def options(self, stage: str):
+        """ONNX Runtime options for the "encoder" or "decoder" session."""
+        import onnxruntime as ort
+        options = ort.SessionOptions()
+        if self.shared:
+            options.use_per_session_threads = False
+            return options
+        options.inter_op_num_threads = 1
+        if self.encoder_threads and stage == "encoder":
+            options.intra_op_num_threads = self.encoder_threads
+            _spinning(options, False)
+        else:
+            options.intra_op_num_threads = self.threads - self.encoder_threads
+            _spinning(options, self.spin == "hybrid")
+        return options
+
+    def describe(self) -> str:
+        if self.shared:
+            return f"{self.threads} threads shared by both stages (process-wide pool, hybrid)"
+        if not self.encoder_threads:
+            return f"{self.threads} threads per stage ({self.spin})"
+        return (f"encoder {self.encoder_threads} threads (park), "
+                f"decoder {self.threads - self.encoder_threads} threads ({self.spin})")
+
+
+def graph_paths(model_cls, model_name: str, models_dir: str = None) -> list:
+    """Encoder and decoder graph paths, found (or downloaded) the way moonshine-onnx does."""
+    if models_dir:
+        return [f"{models_dir}/{graph}.onnx" for graph in ("encoder_model", "decoder_model_merged")]
+    return list(model_cls.__new__(model_cls)._load_weights_from_hf_hub(model_name, "float"))
+
+
+def load_model(model_cls, layout: ThreadLayout, model_name: str, models_dir: str = None):
+    """A moonshine-onnx model whose sessions are created with the layout's options.
+
+    MoonshineOnnxModel's constructor creates its sessions with default
+    options, which ONNX Runtime rejects once the process-wide pool exists, so
+    it is skipped. The attributes generate() needs are read from the
+    decoder's cache inputs instead of from the model name.
+    """
+    import onnxruntime as ort
+    model = model_cls.__new__(model_cls)
+    for name, path in zip(("encoder", "decoder"), graph_paths(model_cls, model_name, models_dir)):
+        setattr(model, name, ort.InferenceSession(str(path), layout.options(name)))
+    names, heads, head_dim = _cache_layout(model)
+    # A decoder and an encoder key and value per layer
+    model.num_layers = len(names) // 4
+    model.num_key_value_heads, model.head_dim = heads, head_dim
+    model.decoder_start_token_id, model.eos_token_id = DECODER_START_TOKEN, EOS_TOKEN
+    return model
+
+
+def fixed_dimensions(model) -> dict:
+    """Symbolic dimensions that are always 1 when streaming, per session.
+
+    That is the batch of both graphs and the decoder's input_ids length (one
+    token per step). Dimensions shared with the decoder cache are left alone:
+    the first step feeds an empty cache.
+    """
+    def symbolic(session, name):
+        shape = next(i.shape for i in session.get_inputs() if i.name == name)
+        return {d for d in shape if isinstance(d, str)}
+
+    cache = {d for i in model.decoder.get_inputs() if i.name.startswith("past_key_values.")
+             for d in i.shape if isinstance(d, str)}
+    encoder_batch = next(i.shape[0] for i in model.encoder.get_inputs() if i.name == "input_values")
+    return {
+        "encoder": {encoder_batch: 1} if isinstance(encoder_batch, str) else {},
+        "decoder": {d: 1 for d in symbolic(model.decoder, "input_ids") - cache},
+    }
+
+
+def _first_logits(model, hidden: np.ndarray) -> np.ndarray:
+    names, heads, head_dim = _cache_layout(model)
+    start = getattr(model, "decoder_start_token_id", DECODER_START_TOKEN)
+    return model.decoder.run(None, {
+        "input_ids": [[start]],
+        "encoder_hidden_states": hidden,
+        "use_cache_branch": [False],
+        **{name: np.zeros((0, heads, 1, head_dim), dtype=np.float32) for name in names},
+    })[0]
+
+
+def specialize(model, layout: ThreadLayout, tolerance: float = 0.0,
+               probe_seconds=(1.0, 1.5, 2.0)) -> str:
+    """Swap in sessions specialised for one window at a time; returns a report line.
+
+    Probe windows run through the generic and the specialised sessions. The
+    encoder output, the first decoder logits and the decoded tokens must
+    match (bit for bit with tolerance 0); otherwise the model keeps its
+    generic sessions.
+    """
+    if not supports_stages(model):
+        return "not available (no separate encoder and decoder sessions)"
+    dims = fixed_dimensions(model)
+    if not any(dims.values()):
+        return "not needed (the graphs have no symbolic batch or step dimensions)"
+    import onnxruntime as ort
+    candidate = copy.copy(model)
+    for name in ("encoder", "decoder"):
+        options = layout.options(name)
+        for dim, value in dims[name].items():
+            options.add_free_dimension_override_by_name(dim, value)
+        session = getattr(model, name)
+        setattr(candidate, name, ort.InferenceSession(
+            session._model_path, options, providers=session.get_providers()))
+
+    worst = 0.0
+    rng = np.random.default_rng(0)
+    for seconds in probe_seconds:
+        audio = (rng.standard_normal((1, int(16000 * seconds))) * 0.1).astype(np.float32)
+        hidden, ours = encode(model, audio), encode(candidate, audio)
+        logits, our_logits = _first_logits(model, hidden), _first_logits(candidate, ours)
+        if hidden.shape != ours.shape or logits.shape != our_logits.shape:
+            return f"rejected: output shapes differ on a {seconds} s window"
+        worst = max(worst, float(np.abs(hidden - ours).max()), float(np.abs(logits - our_logits).max()))
+        max_len = int(seconds * TOKENS_PER_SECOND)
+        if worst > tolerance or decode(model, hidden, max_len) != decode(candidate, ours, max_len):
+            return f"rejected: differs from the generic sessions (max difference {worst:.3g})"
+
+    model.encoder, model.decoder = candidate.encoder, candidate.decoder
+    pinned = ", ".join(f"{dim}=1" for dim in sorted({d for ds in dims.values() for d in ds}))
+    match = "bit-identical" if worst == 0 else f"max difference {worst:.3g}"
+    return f"{pinned} ({match} on {len(probe_seconds)} probe windows)"
+
+
+def supports_stages(model) -> bool:
+    return hasattr(model, "encoder") and hasattr(model, "decoder")
+
+
+def _cache_layout(model):
+    """(cache input names, kv heads, head dim) read from the decoder session."""
+    cache = [i for i in model.decoder.get_inputs() if i.name.startswith("past_key_values.")]
+    shape = cache[0].shape
+    return [i.name for i in cache], shape[1], shape[3]
+
+
+def encode(model, audio: np.ndarray) -> np.ndarray:
+    """Run the encoder stage on a (1, samples) float32 window."""
+    return model.encoder.run(None, {"input_values": audio})[0]
+
+
+def _input_names(session) -> set:
+    return {i.name for i in session.get_inputs()}
+
+
+def masks_padding(model) -> bool:
+    """True if zero-padding a batch cannot change the output (both graphs take a mask)."""
+    return ("attention_mask" in _input_names(model.encoder)
+            and "encoder_attention_mask" in _input_names(model.decoder))
+
+
+def encode_batch(model, audio: np.ndarray, lengths: list):
+    """Encode a zero-padded (batch, samples) array.
+
+    Returns (hidden states, encoder mask or None). The mask marks the hidden
+    frames that cover real audio. It is only built when the graphs take one.
+    """
+    feeds = {"input_values": audio}
+    if "attention_mask" in _input_names(model.encoder):
+        mask = np.zeros(audio.shape, dtype=np.int64)
+        for row, length in enumerate(lengths):
+            mask[row, :length] = 1
+        feeds["attention_mask"] = mask
+    hidden = model.encoder.run(None, feeds)[0]
+    if "encoder_attention_mask" not in _input_names(model.decoder):
+        return hidden, None
+    frames = hidden.shape[1]
+    mask = np.zeros((len(lengths), frames), dtype=np.int64)
+    for row, length in enumerate(lengths):
+        mask[row, :int(np.ceil(frames * length / audio.shape[1]))] = 1
+    return hidden, mask
+
+
+def decode(model, hidden: np.ndarray, max_len: int, on_token=None) -> list:
+    """Greedy-decode encoder output; returns the token ids, passing each to on_token as it comes."""
+    names, heads, head_dim = _cache_layout(model)
+    past = {name: np.zeros((0, heads, 1, head_dim), dtype=np.float32) for name in names}
+    start = getattr(model, "decoder_start_token_id", DECODER_START_TOKEN)
+    eos = getattr(model, "eos_token_id", EOS_TOKEN)
+
+    tokens = [start]
+    input_ids = [tokens]
+    for step in range(max_len):
+        use_cache = step > 0
+        logits, *present = model.decoder.run(None, {
+            "input_ids": input_ids,
+            "encoder_hidden_states": hidden,
+            "use_cache_branch": [use_cache],
+            **past,
+        })
+        token = int(logits[0, -1].argmax())
+        tokens.append(token)
+        if on_token:
+            on_token(token)
+        if token == eos:
+            break
+        input_ids = [[token]]
+        for name, value in zip(names, present):
+            # Cross-attention cache is computed once, on the first step
+            if not use_cache or "decoder" in name:
+                past[name] = value
+    return tokens
+
+
+def decode_batch(model, hidden: np.ndarray, max_lens: list, mask: np.ndarray = None) -> list:
+    """Greedy-decode a batch of encoder outputs; returns token ids per row.
+
+    Rows that reached EOS or their own length budget keep stepping with the
+    rest of the batch, but their further tokens are discarded.
+    """
+    names, heads, head_dim = _cache_layout(model)
+    past = {name: np.zeros((0, heads, 1, head_dim), dtype=np.float32) for name in names}
+    start = getattr(model, "decoder_start_token_id", DECODER_START_TOKEN)
+    eos = getattr(model, "eos_token_id", EOS_TOKEN)
+    extra = {"encoder_attention_mask": mask} if mask is not None else {}
+
+    rows = hidden.shape[0]
+    tokens = [[start] for _ in range(rows)]
+    done = [False] * rows
+    input_ids = [[start]] * rows
+    for step in range(max(max_lens)):
+        use_cache = step > 0
+        logits, *present = model.decoder.run(None, {
+            "input_ids": input_ids,
+            "encoder_hidden_states": hidden,
+            "use_cache_branch": [use_cache],
+            **extra,
+            **past,
+        })
+        chosen = logits[:, -1].argmax(axis=-1)
+        for row, token in enumerate(chosen):
+            if done[row]:
+                continue
+            tokens[row].append(int(token))
+            done[row] = token == eos or len(tokens[row]) > max_lens[row]
+        if all(done):
+            break
+        input_ids = [[int(token)] for token in chosen]
+        for name, value in zip(names, present):
+            # Cross-attention cache is computed once, on the first step
+            if not use_cache or "decoder" in name:
+                past[name] = value
+    return tokens
+
+
+class StagePipeline:
+    """Encode/decode pipeline for one session over shared stage pools."""
+
+    def __init__(self, transcriber, encoder_pool: ThreadPoolExecutor,
+                 decoder_pool: ThreadPoolExecutor, depth: int = DEFAULT_PIPELINE_DEPTH):
+        self.transcriber = transcriber
+        self.encoder_pool = encoder_pool
+        self.decoder_pool = decoder_pool
+        self.queue = asyncio.Queue(maxsize=depth)
+        self.decoding = False
+        self.stats = {"windows": 0, "overlapped": 0, "encode_ms": 0.0, "decode_ms": 0.0}
+
+    async def submit(self, audio: np.ndarray, meta: dict, on_partial=None):
+        """Start encoding a window; waits while ``depth`` windows await decoding.
+
+        on_partial(text so far) is called from the decoder thread while the window decodes.
+        """
+        loop = asyncio.get_running_loop()
+        if self.decoding:
+            self.stats["overlapped"] += 1
+        encoded = loop.run_in_executor(self.encoder_pool, self._timed, "encode_ms",
+                                       self.transcriber.encode, audio)
+        await self.queue.put((encoded, meta, on_partial))
+
+    async def results(self):
+        """Yield (text, meta) for each submitted window, in order."""
+        loop = asyncio.get_running_loop()
+        while True:
+            encoded, meta, on_partial = await self.queue.get()
+            try:
+                try:
+                    stage = await encoded
+                except Exception as e:
+                    print(f"Encoder error: {e}")
+                    continue
+                self.decoding = True
+                try:
+                    text = await loop.run_in_executor(self.decoder_pool, self._timed, "decode_ms",
+                                                      self.transcriber.decode, stage, on_partial)
+                finally:
+                    self.decoding = False
+                self.stats["windows"] += 1
+                yield text, meta
+            finally:
+                # Done once the consumer comes back for the next window
+                self.queue.task_done()
+
+    async def drain(self):
+        """Wait until every submitted window has been consumed from results()."""
+        await self.queue.join()
+
+    def _timed(self, key: str, fn, *args):
+        started = time.perf_counter()
+        try:
+            return fn(*args)
+        finally:
+            self.stats[key] += (time.perf_counter() - started) * 1000
+
+    def summary(self) -> str:
+        n = max(self.stats["windows"], 1)
+        return (f"{self.stats['windows']} windows, {self.stats['overlapped']} encoded during a decode, "
+                f"encode {self.stats['encode_ms'] / n:.0f} ms, decode {self.stats['decode_ms'] / n:.0f} ms avg")
+
+
+DEFAULT_BATCH_WAIT_MS = 20
+DEFAULT_BUCKET_MS = 250
+
+
+class WindowBatcher:
+    """Groups ready windows from all sessions into length buckets and runs them as batches."""
+
+    def __init__(self, transcriber, pool: ThreadPoolExecutor, workers: int, max_batch: int,
+                 wait_ms: float = DEFAULT_BATCH_WAIT_MS, bucket_ms: float = DEFAULT_BUCKET_MS):
+        self.transcriber = transcriber
+        self.pool = pool
+        self.max_batch = max_batch
+        self.wait = wait_ms / 1000
+        self.bucket_samples = max(int(bucket_ms * 16), 1)
+        self.waiting = []  # (bucket, audio, future), oldest first; see bucket()
+        self.wakeup = asyncio.Event()
+        self.slots = asyncio.Semaphore(workers)
+        self.stats = {"batches": 0, "windows": 0, "largest": 0, "samples": 0, "padded": 0}
+
+    def submit(self, audio: np.ndarray) -> asyncio.Future:
+        """Queue one window; the future resolves to (text, compute seconds for this window)."""
+        future = asyncio.get_running_loop().create_future()
+        self.waiting.append((self.bucket(len(audio)), audio, future))
+        self.wakeup.set()
+        return future
+
+    def bucket(self, samples: int):
+        """Windows with the same key share a batch: exact lengths unless padding is masked."""
+        model = self.transcriber.model
+        if model is not None and supports_stages(model) and not masks_padding(model):
+            return ("exact", samples)
+        return samples // self.bucket_samples
+
+    async def run(self):
+        """Dispatch loop; start once per server with asyncio.create_task."""
+        loop = asyncio.get_running_loop()
+        while True:
+            await self.wakeup.wait()
+            self.wakeup.clear()
+            while self.waiting:
+                # Wait for a free worker; windows arriving meanwhile join the batch
+                await self.slots.acquire()
+                if len(self.waiting) < self.max_batch:
+                    await asyncio.sleep(self.wait)
+                batch = self.take()
+                loop.create_task(self.dispatch(batch))
+
+    def take(self) -> list:
+        """Up to max_batch windows from the oldest window's bucket."""
+        bucket = self.waiting[0][0]
+        batch = [w for w in self.waiting if w[0] == bucket][:self.max_batch]
+        taken = {id(w) for w in batch}
+        self.waiting = [w for w in self.waiting if id(w) not in taken]
+        return batch
+
+    async def dispatch(self, batch: list):
+        try:
+            audios = [audio for _, audio, _ in batch]
+            started = time.perf_counter()
+            try:
+                texts = await asyncio.get_running_loop().run_in_executor(
+                    self.pool, self.transcriber.transcribe_batch, audios)
+            except Exception as e:
+                print(f"Batch transcription error: {e}")
+                texts = [""] * len(batch)
+            share = (time.perf_counter() - started) / len(batch)
+            longest = max(len(a) for a in audios)
+            self.stats["batches"] += 1
+            self.stats["windows"] += len(batch)
+            self.stats["largest"] = max(self.stats["largest"], len(batch))
+            self.stats["samples"] += longest * len(batch)
+            self.stats["padded"] += sum(longest - len(a) for a in audios)
+            for (_, _, future), text in zip(batch, texts):
+                if not future.done():
+                    future.set_result((text, share))
+        finally:
+            self.slots.release()
+
+    def summary(self) -> str:
+        batches = max(self.stats["batches"], 1)
+        return (f"{self.stats['windows']} windows in {self.stats['batches']} batches "
+                f"(avg {self.stats['windows'] / batches:.1f}, largest {self.stats['largest']}), "
+                f"padding {self.stats['padded'] / max(self.stats['samples'], 1):.1%}")
+
+
+class BatchPipeline:
+    """Per-session front of a shared WindowBatcher, with StagePipeline's interface."""
+
+    def __init__(self, batcher: WindowBatcher, depth: int = DEFAULT_PIPELINE_DEPTH):
+        self.batcher = batcher
+        self.queue = asyncio.Queue(maxsize=depth)
+        self.stats = {"windows": 0, "overlapped": 0, "encode_ms": 0.0, "decode_ms": 0.0}
+
+    async def submit(self, audio: np.ndarray, meta: dict, on_partial=None):
+        """Queue a window for the next batch; waits while ``depth`` windows are outstanding.
+
+        Batches decode all rows together, so there are no partials (on_partial is ignored).
+        """
+        await self.queue.put((self.batcher.submit(audio), meta))
+
+    async def results(self):
+        """Yield (text, meta) for each submitted window, in order."""
+        while True:
+            future, meta = await self.queue.get()
+            try:
+                text, seconds = await future
+                # Encode and decode share one batched call; book it all as decode
+                self.stats["decode_ms"] += seconds * 1000
+                self.stats["windows"] += 1
+                yield text, meta
+            finally:
+                self.queue.task_done()
+
+    async def drain(self):
+        """Wait until every submitted window has been consumed from results()."""
+        await self.queue.join()
+
+    def summary(self) -> str:
+        n = max(self.stats["windows"], 1)
+        return f"{self.stats['windows']} windows batched, {self.stats['decode_ms'] / n:.0f} ms per window"
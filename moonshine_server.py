@@ -8,6 +8,7 @@ import json
 import wave
 import tempfile
 import os
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 
 try:
@@ -20,6 +21,17 @@ except ImportError:
     import websockets
     import numpy as np
 
+from flow_control import AudioInbox
+from datagram_transport import DatagramAudioServer
+from caption_hub import CaptionHub
+from server_health import ServerHealth, chain_requests
+from heap_accounting import HeapAccounting, session_bytes
+from detokenizer import Detokenizer
+from session_migration import SessionMigrator, MIGRATE_PATH
+from moonshine_engine import (StagePipeline, BatchPipeline, WindowBatcher, supports_stages, encode, decode,
+                              encode_batch, decode_batch, masks_padding, load_model, specialize,
+                              ThreadLayout, DEFAULT_PIPELINE_DEPTH, DEFAULT_BATCH_WAIT_MS, DEFAULT_BUCKET_MS, TOKENS_PER_SECOND, SPIN_POLICIES)
+
 # Try to import Moonshine ONNX
 MOONSHINE_AVAILABLE = False
 try:
@@ -55,21 +67,70 @@ MOONSHINE_MODELS = {
     "moonshine/base-es": {"size": "62M", "description": "Fast, Spanish"},
 }
 
+# Local model directories, shared with the in-app engines (electron/model-paths.cjs).
+# A directory holding encoder_model.onnx and decoder_model_merged.onnx is loaded
+# from disk; quantize_moonshine.py writes its variants here (e.g. base-int8/).
+MOONSHINE_DIR = Path(os.environ.get("SFA_MOONSHINE_DIR") or Path(__file__).parent.parent / "models" / "moonshine")
+VARIANT_INFO = "quantization.json"
+
+
+def local_model_dir(model_name: str):
+    """Directory of a locally stored model, or None to fetch it by name."""
+    directory = MOONSHINE_DIR / model_name.split("/", 1)[-1]
+    if (directory / "encoder_model.onnx").exists() and (directory / "decoder_model_merged.onnx").exists():
+        return directory
+    return None
+
+
+def source_model(model_name: str) -> str:
+    """The published model a local variant was made from (its architecture)."""
+    directory = local_model_dir(model_name)
+    if directory and (directory / VARIANT_INFO).exists():
+        return json.loads((directory / VARIANT_INFO).read_text())["source"]
+    return "moonshine/" + model_name.split("/", 1)[-1].split("-", 1)[0]
+
+
+def register_local_variants():
+    """Add quantized variants found under MOONSHINE_DIR to MOONSHINE_MODELS."""
+    if not MOONSHINE_DIR.is_dir():
+        return
+    for info_path in sorted(MOONSHINE_DIR.glob(f"*/{VARIANT_INFO}")):
+        name = f"moonshine/{info_path.parent.name}"
+        if name in MOONSHINE_MODELS or not local_model_dir(name):
+            continue
+        info = json.loads(info_path.read_text())
+        size = sum(f.stat().st_size for f in info_path.parent.glob("*.onnx")) / 1e6
+        MOONSHINE_MODELS[name] = {
+            "size": f"{size:.0f} MB",
+            "description": f"{info['source']}, {info['description']}",
+        }
+
+
+register_local_variants()
+
 
 class MoonshineTranscriber:
     """Handles audio transcription using Moonshine ONNX models."""
     
-    def __init__(self, model_name="moonshine/base"):
+    def __init__(self, model_name="moonshine/base", threads=0, spin="hybrid", specialized=False,
+                 tolerance=0.0, encoder_threads=0, shared_pool=None):
         self.model_name = model_name
         self.model = None
         self.tokenizer = None
+        self.detokenizer = None
         self.rate = 16000
+        # Stage thread pools (see moonshine_engine.ThreadLayout)
+        self.layout = ThreadLayout(threads, spin, encoder_threads, shared_pool)
+        # Sessions pinned to one window per call (see moonshine_engine.specialize)
+        self.specialized = specialized
+        self.tolerance = tolerance
         
         if MOONSHINE_AVAILABLE:
             print(f"Loading Moonshine model: {model_name}...")
             try:
-                self.model = MoonshineOnnxModel(model_name=model_name)
+                self.model = self._load(model_name)
                 self.tokenizer = load_tokenizer()
+                self.detokenizer = self._detokenizer()
                 # Warmup inference
                 self._warmup()
                 print(f"✓ Moonshine model '{model_name}' loaded successfully!")
@@ -77,6 +138,36 @@ class MoonshineTranscriber:
                 print(f"✗ Failed to load Moonshine model: {e}")
                 self.model = None
     
+    def _load(self, model_name: str):
+        """Load a model with its sessions created under the configured thread layout."""
+        directory = local_model_dir(model_name)
+        if not hasattr(MoonshineOnnxModel, "_load_weights_from_hf_hub"):
+            # Older releases build other sessions, with default options (per-session pools only)
+            if directory:
+                return MoonshineOnnxModel(models_dir=str(directory), model_name=source_model(model_name))
+            return MoonshineOnnxModel(model_name=model_name)
+        model = load_model(MoonshineOnnxModel, self.layout, model_name, str(directory) if directory else None)
+        print(f"  Thread pools: {self.layout.describe()}")
+        if self.specialized:
+            try:
+                print(f"  Specialised sessions: {specialize(model, self.layout, self.tolerance)}")
+            except Exception as e:
+                print(f"⚠ Could not specialise sessions: {e}")
+        return model
+    
+    def _detokenizer(self):
+        """Incremental detokenizer over the same vocabulary (see detokenizer.py)."""
+        try:
+            return Detokenizer(self.tokenizer.to_str())
+        except Exception as e:
+            print(f"⚠ Incremental detokenizer unavailable, decoding whole windows: {e}")
+            return None
+    
+    def detokenize(self, tokens) -> str:
+        if self.detokenizer:
+            return self.detokenizer.decode(tokens)
+        return self.tokenizer.decode_batch([tokens])[0].strip()
+    
     def _warmup(self):
         """Warmup the model with a short inference."""
         if self.model:
@@ -96,7 +187,7 @@ class MoonshineTranscriber:
             
         try:
             print(f"Switching to Moonshine model: {model_name}...")
-            self.model = MoonshineOnnxModel(model_name=model_name)
+            self.model = self._load(model_name)
             self.model_name = model_name
             self._warmup()
             print(f"✓ Model switched to: {model_name}")
@@ -107,21 +198,74 @@ class MoonshineTranscriber:
     
     def transcribe(self, audio_data: np.ndarray) -> str:
         """Transcribe audio data to text."""
-        if not self.model or not MOONSHINE_AVAILABLE:
+        return self.decode(self.encode(audio_data))
+    
+    def encode(self, audio_data: np.ndarray):
+        """Encoder stage; returns the state decode() finishes.
+        
+        The model is captured here so a model switch between the two stages
+        cannot mix encoder and decoder of different models.
+        """
+        # Ensure audio is in correct shape (1, num_samples)
+        if audio_data.ndim == 1:
+            audio_data = audio_data[np.newaxis, :]
+        audio_data = audio_data.astype(np.float32)
+        
+        model = self.model if MOONSHINE_AVAILABLE else None
+        if model is None or not supports_stages(model):
+            return model, audio_data, None
+        return model, audio_data, encode(model, audio_data)
+    
+    def transcribe_batch(self, windows: list) -> list:
+        """Transcribe several windows with one batched encoder and decoder run."""
+        model = self.model if MOONSHINE_AVAILABLE else None
+        if model is None or not supports_stages(model) or len(windows) == 1:
+            return [self.transcribe(w) for w in windows]
+        # Without masks, padding would change the shorter windows' output
+        if not masks_padding(model) and len({len(w) for w in windows}) > 1:
+            return [self.transcribe(w) for w in windows]
+        
+        try:
+            lengths = [len(w) for w in windows]
+            audio = np.zeros((len(windows), max(lengths)), dtype=np.float32)
+            for row, window in enumerate(windows):
+                audio[row, :len(window)] = window
+            hidden, mask = encode_batch(model, audio, lengths)
+            max_lens = [int(n / self.rate * TOKENS_PER_SECOND) for n in lengths]
+            tokens = decode_batch(model, hidden, max_lens, mask)
+            return [self.detokenize(row) for row in tokens]
+        except Exception as e:
+            print(f"Batch transcription error: {e}")
+            return [""] * len(windows)
+    
+    def decode(self, stage, on_partial=None) -> str:
+        """Decoder stage: greedy decode and detokenize.
+        
+        on_partial(text so far) is called from this thread whenever the text
+        grows by complete characters.
+        """
+        model, audio_data, hidden = stage
+        if model is None:
             return "[Moonshine not available - install with: pip install useful-moonshine-onnx]"
         
         try:
-            # Ensure audio is in correct shape (1, num_samples)
-            if audio_data.ndim == 1:
-                audio_data = audio_data[np.newaxis, :]
+            if hidden is None:
+                # No separate sessions: run the whole model here
+                return self.detokenize(model.generate(audio_data)[0])
             
-            # Generate tokens
-            tokens = self.model.generate(audio_data.astype(np.float32))
+            max_len = int(audio_data.shape[-1] / self.rate * TOKENS_PER_SECOND)
+            if not self.detokenizer:
+                return self.detokenize(decode(model, hidden, max_len))
             
-            # Decode tokens to text
-            text = self.tokenizer.decode_batch(tokens)[0]
+            # Detokenize as tokens arrive instead of re-decoding the list
+            stream = self.detokenizer.stream()
             
-            return text.strip()
+            def on_token(token):
+                if stream.push(token) and on_partial:
+                    on_partial(stream.text)
+            
+            decode(model, hidden, max_len, on_token)
+            return stream.finish()
             
         except Exception as e:
             print(f"Transcription error: {e}")
@@ -131,20 +275,80 @@ class MoonshineTranscriber:
 class MoonshineWebSocketServer:
     """WebSocket server for Moonshine transcription."""
     
-    def __init__(self, host="0.0.0.0", port=9091, model_name="moonshine/base"):
+    def __init__(self, host="0.0.0.0", port=9091, model_name="moonshine/base",
+                 udp_port=None, udp_loss=0.0, encoder_workers=1, decoder_workers=2,
+                 pipeline_depth=DEFAULT_PIPELINE_DEPTH, threads=0, spin="hybrid", max_sessions=0,
+                 peers=(), migrate_secret=None, rebalance_load=0.0, batch_size=1,
+                 batch_wait_ms=DEFAULT_BATCH_WAIT_MS, bucket_ms=DEFAULT_BUCKET_MS, specialized=False,
+                 tolerance=0.0, trace_alloc=False, encoder_threads=None, rebalance_lag_ms=0):
+        # First, so allocation tracing sees the model load
+        self.heap = HeapAccounting(trace_alloc)
         self.host = host
         self.port = port
-        self.transcriber = MoonshineTranscriber(model_name)
+        # Overlapping stages split the threads; a batch runs its stages back to back
+        if batch_size > 1:
+            encoder_threads = 0
+        self.transcriber = MoonshineTranscriber(model_name, threads, spin, specialized, tolerance,
+                                                encoder_threads)
+        # Stage pools shared by all sessions; see moonshine_engine.py
+        self.encoder_pool = ThreadPoolExecutor(encoder_workers, thread_name_prefix="moonshine-encoder")
+        self.decoder_pool = ThreadPoolExecutor(decoder_workers, thread_name_prefix="moonshine-decoder")
+        self.pipeline_depth = pipeline_depth
+        # Cross-session batching replaces the per-session stage split
+        self.batcher = None
+        if batch_size > 1:
+            if MOONSHINE_AVAILABLE and self.transcriber.model is None:
+                print("⚠ Batching without a loaded model: every window gets simulated text")
+            self.batcher = WindowBatcher(self.transcriber, self.decoder_pool, decoder_workers, batch_size,
+                                         batch_wait_ms, bucket_ms)
         self.clients = set()
+        self.udp_port = udp_port
+        self.datagram = DatagramAudioServer(loss=udp_loss) if udp_port is not None else None
+        self.hub = CaptionHub()
+        # Decoding dominates, so the decoder pool is the capacity
+        self.health = ServerHealth("moonshine", lambda: self.transcriber.model_name,
+                                   workers=decoder_workers, max_sessions=max_sessions)
+        self.migrator = SessionMigrator("moonshine", self.health, peers, migrate_secret, rebalance_load,
+                                        rebalance_lag_ms)
         
     async def handle_client(self, websocket):
         """Handle a WebSocket client connection."""
         client_id = id(websocket)
+        
+        # Read-only caption viewers connect on /subscribe/<channel>
+        channel = self.hub.channel_from_path(websocket.request.path)
+        if channel:
+            await self.hub.subscribe(websocket, channel)
+            return
+        
+        # A peer handing over a session (session_migration.py)
+        if websocket.request.path == MIGRATE_PATH:
+            await self.migrator.receive(websocket)
+            return
+        
+        # Full or draining: the client fails over to another server
+        if not self.health.accepting():
+            await websocket.close(1013, self.health.snapshot()["status"])
+            return
+        
         self.clients.add(websocket)
         print(f"Client {client_id} connected. Total clients: {len(self.clients)}")
         
-        audio_buffer = np.array([], dtype=np.float32)
-        config = {"model": "moonshine/base"}
+        inbox = AudioInbox()
+        self.health.session_started(websocket, inbox)
+        datagram_token = None
+        # Everything a migration needs to carry over lives here
+        session = {
+            "channel": None,
+            "config": {"model": "moonshine/base"},
+            "audio": np.array([], dtype=np.float32),  # not yet submitted (plus the overlap)
+            "segment_id": 0,
+            "stream_samples": 0,
+            "migrating": False,
+        }
+        self.heap.session_started(websocket, lambda: session_bytes(session, inbox, websocket))
+        processor = asyncio.create_task(self.process_audio(websocket, inbox, session))
+        self.migrator.register(websocket, session, inbox, processor)
         
         try:
             # Send ready message
@@ -153,7 +357,8 @@ class MoonshineWebSocketServer:
                 "status": "ready",
                 "backend": "moonshine",
                 "model": self.transcriber.model_name,
-                "available_models": list(MOONSHINE_MODELS.keys())
+                "available_models": list(MOONSHINE_MODELS.keys()),
+                **inbox.ready_fields(),
             }))
             
             async for message in websocket:
@@ -162,6 +367,20 @@ class MoonshineWebSocketServer:
                     try:
                         data = json.loads(message)
                         print(f"Client {client_id} config: {data}")
+                        session["config"] = data
+                        
+                        # Session moved here from another server
+                        if data.get('resume'):
+                            state = self.migrator.claim(data['resume'])
+                            if state:
+                                session["segment_id"] = state["segment_id"]
+                                session["stream_samples"] += state["stream_samples"]
+                                session["audio"] = np.concatenate([state["audio"], session["audio"]])
+                                print(f"Client {client_id} resumed a migrated session at segment {state['segment_id']}")
+                            await websocket.send(json.dumps({
+                                "type": "resumed" if state else "resume_failed",
+                                "segment_id": session["segment_id"],
+                            }))
                         
                         # Handle model change
                         if 'model' in data and data['model'].startswith('moonshine/'):
@@ -187,46 +406,125 @@ class MoonshineWebSocketServer:
                                     "type": "model_error",
                                     "error": f"Failed to load {model_name}"
                                 }))
+                        
+                        # Audio over UDP datagrams, results stay on this socket
+                        if data.get('transport') == 'datagram' and self.datagram and not datagram_token:
+                            transport = self.datagram.register(inbox)
+                            datagram_token = transport["token"]
+                            await websocket.send(json.dumps(transport))
+                        
+                        # Publish this session's captions to read-only viewers
+                        if data.get('publish') and not session["channel"]:
+                            reply = self.hub.start_publishing(data['publish'])
+                            if reply:
+                                if reply["type"] == "publishing":
+                                    session["channel"] = data['publish']
+                                await websocket.send(json.dumps(reply))
                                 
                     except json.JSONDecodeError:
                         pass
                         
                 elif isinstance(message, bytes):
-                    # Binary audio data
-                    audio_chunk = np.frombuffer(message, dtype=np.float32)
-                    audio_buffer = np.concatenate([audio_buffer, audio_chunk])
-                    
-                    # Transcribe when we have enough audio (1.5 seconds at 16kHz)
-                    # Moonshine is fast enough to process smaller chunks
-                    if len(audio_buffer) >= 24000:
-                        # Transcribe
-                        text = self.transcriber.transcribe(audio_buffer)
-                        
-                        if text:
-                            # Send transcription result
-                            result = {
-                                "type": "TRANSCRIPTION",
-                                "segments": [{
-                                    "text": text,
-                                    "start": 0,
-                                    "end": len(audio_buffer) / 16000
-                                }],
-                                "backend": "moonshine"
-                            }
-                            await websocket.send(json.dumps(result))
-                            print(f"[Moonshine] Transcribed: {text}")
-                        
-                        # Keep last 0.3 seconds for context (Moonshine is fast)
-                        audio_buffer = audio_buffer[-4800:]
+                    # Binary audio data, transcribed by process_audio
+                    inbox.put(np.frombuffer(message, dtype=np.float32))
                         
         except websockets.exceptions.ConnectionClosed:
             print(f"Client {client_id} disconnected")
         except Exception as e:
             print(f"Error handling client {client_id}: {e}")
         finally:
+            processor.cancel()
+            if inbox.overruns:
+                print(f"Client {client_id} sent {inbox.overruns} frames beyond its credit")
+            if datagram_token:
+                print(f"Client {client_id} datagram stats: {self.datagram.unregister(datagram_token)}")
+            if session["channel"]:
+                self.hub.stop_publishing(session["channel"])
+            self.health.session_ended(websocket)
+            self.heap.session_ended(websocket)
+            self.migrator.unregister(websocket)
             self.clients.discard(websocket)
             print(f"Client {client_id} removed. Remaining: {len(self.clients)}")
     
+    async def process_audio(self, websocket, inbox: AudioInbox, session: dict):
+        """Cut queued audio into 1.5 second windows and feed the encode/decode pipeline.
+
+        All state lives in session so a migration can carry it to a peer.
+        """
+        if self.batcher:
+            pipeline = BatchPipeline(self.batcher, self.pipeline_depth)
+        else:
+            pipeline = StagePipeline(self.transcriber, self.encoder_pool, self.decoder_pool,
+                                     self.pipeline_depth)
+        sender = asyncio.create_task(self.send_results(websocket, pipeline, session))
+        loop = asyncio.get_running_loop()
+        
+        def send_partial(text: str):
+            # Called on a decoder thread while a window decodes
+            if session["config"].get("partials"):
+                asyncio.run_coroutine_threadsafe(websocket.send(json.dumps({
+                    "type": "partial",
+                    "partial": text,
+                    "backend": "moonshine",
+                })), loop)
+        
+        try:
+            while True:
+                frames = await inbox.get_batch()
+                await websocket.send(inbox.credit_message())
+                session["stream_samples"] += sum(len(f) for f in frames)
+                session["audio"] = np.concatenate([session["audio"], *frames])
+                if session["migrating"]:
+                    # Windows already submitted still reach this client; the rest goes to a peer
+                    await pipeline.drain()
+                    return
+                
+                # Transcribe when we have enough audio (1.5 seconds at 16kHz)
+                # Moonshine is fast enough to process smaller chunks
+                audio_buffer = session["audio"]
+                if len(audio_buffer) >= 24000:
+                    # Times are seconds since session start
+                    end = session["stream_samples"] / 16000
+                    await pipeline.submit(audio_buffer, {
+                        "start": round(end - len(audio_buffer) / 16000, 3),
+                        "end": round(end, 3)
+                    }, send_partial)
+                    
+                    # Keep last 0.3 seconds for context (Moonshine is fast)
+                    session["audio"] = audio_buffer[-4800:]
+        except websockets.exceptions.ConnectionClosed:
+            pass
+        finally:
+            sender.cancel()
+            if pipeline.stats["windows"]:
+                print(f"[Moonshine] Pipeline: {pipeline.summary()}")
+            if self.batcher:
+                print(f"[Moonshine] Batcher: {self.batcher.summary()}")
+    
+    async def send_results(self, websocket, pipeline, session: dict):
+        """Send decoded windows to the client in order."""
+        compute_ms = 0.0
+        try:
+            async for text, meta in pipeline.results():
+                total_ms = pipeline.stats["encode_ms"] + pipeline.stats["decode_ms"]
+                self.health.record(meta["end"] - meta["start"], (total_ms - compute_ms) / 1000)
+                compute_ms = total_ms
+                if not text:
+                    continue
+                segment = {"id": session["segment_id"], "rev": 0, "text": text, **meta}
+                session["segment_id"] += 1
+                result = {
+                    "type": "TRANSCRIPTION",
+                    "segments": [segment],
+                    "backend": "moonshine"
+                }
+                await websocket.send(json.dumps(result))
+                if session["channel"]:
+                    self.hub.publish(session["channel"], segment)
+                print(f"[Moonshine] Transcribed: {text}")
+        except websockets.exceptions.ConnectionClosed:
+            pass
+    
     async def start(self):
         """Start the WebSocket server."""
         print(f"\n{'='*55}")
@@ -243,10 +541,24 @@ class MoonshineWebSocketServer:
             print(f"    - {name}: {info['size']} - {info['description']}")
         print(f"\n{'='*55}\n")
         
-        async with websockets.serve(self.handle_client, self.host, self.port):
+        if self.datagram:
+            await self.datagram.start(self.host, self.udp_port)
+        
+        self.migrator.start()
+        if self.batcher:
+            print(f"  Batching: up to {self.batcher.max_batch} windows per call")
+            asyncio.create_task(self.batcher.run())
+        
+        # /health for client server selection, /drain to hand sessions to peers,
+        # /overlay/<channel> for viewers, /metrics for memory per session and stage
+        async with websockets.serve(self.handle_client, self.host, self.port,
+                                    process_request=chain_requests(self.health.process_request,
+                                                                   self.migrator.process_request,
+                                                                   self.hub.process_request,
+                                                                   self.heap.process_request)):
             print(f"✓ Moonshine server running on ws://{self.host}:{self.port}")
             print("Waiting for connections...\n")
-            await asyncio.Future()  # Run forever
+            await self.migrator.stopped.wait()  # Until drained
 
 
 def main():
@@ -257,10 +569,56 @@ def main():
     parser.add_argument("--model", default="moonshine/base", 
                         choices=list(MOONSHINE_MODELS.keys()),
                         help="Moonshine model to use")
+    parser.add_argument("--udp-port", type=int, default=None,
+                        help="Also accept audio as UDP datagrams with FEC on this port")
+    parser.add_argument("--udp-loss", type=float, default=0.0,
+                        help="Simulated datagram loss (0-1) for testing")
+    parser.add_argument("--encoder-workers", type=int, default=1,
+                        help="Threads running encoder stages, shared by all sessions")
+    parser.add_argument("--decoder-workers", type=int, default=2,
+                        help="Threads running decoder stages, shared by all sessions")
+    parser.add_argument("--pipeline-depth", type=int, default=DEFAULT_PIPELINE_DEPTH,
+                        help="Encoded windows a session may queue ahead of its decoder")
+    parser.add_argument("--threads", type=int, default=0,
+                        help="Intra-op threads, split between the encoder and decoder (0 = one per CPU)")
+    parser.add_argument("--encoder-threads", type=int, default=None,
+                        help="The encoder's share of --threads (default: half; 0 = no split)")
+    parser.add_argument("--spin-policy", default="hybrid", choices=SPIN_POLICIES,
+                        help="Idle decoder pool threads spin before parking (hybrid) or park at once")
+    parser.add_argument("--max-sessions", type=int, default=0,
+                        help="Refuse new capture sessions beyond this many (0 = no limit)")
+    parser.add_argument("--peers", default="",
+                        help="Comma-separated servers to migrate sessions to when draining, e.g. ws://host2:9091")
+    parser.add_argument("--migrate-secret", default=os.environ.get("SFA_MIGRATE_SECRET"),
+                        help="Shared secret peers must present to hand over sessions (default: $SFA_MIGRATE_SECRET)")
+    parser.add_argument("--rebalance-load", type=float, default=0.0,
+                        help="Move sessions to a peer while load stays above this (0 = off)")
+    parser.add_argument("--rebalance-lag-ms", type=int, default=0,
+                        help="Move sessions to a peer while a session lags by more than this (0 = off)")
+    parser.add_argument("--batch-size", type=int, default=1,
+                        help="Batch up to this many windows from different sessions per model call (1 = off)")
+    parser.add_argument("--batch-wait-ms", type=float, default=DEFAULT_BATCH_WAIT_MS,
+                        help="How long a partial batch waits for more windows")
+    parser.add_argument("--bucket-ms", type=float, default=DEFAULT_BUCKET_MS,
+                        help="Only windows whose lengths fall in the same bucket of this size share a batch")
+    parser.add_argument("--specialize", action="store_true",
+                        help="Pin the sessions to one window per call, if they reproduce the generic output")
+    parser.add_argument("--specialize-tolerance", type=float, default=0.0,
+                        help="Largest output difference accepted from specialised sessions (0 = bit for bit)")
+    parser.add_argument("--trace-alloc", action="store_true",
+                        help="Trace Python allocations and report them per pipeline stage on /metrics (slower)")
     
     args = parser.parse_args()
+    if args.specialize and args.batch_size > 1:
+        parser.error("--specialize runs one window per call; it cannot be combined with --batch-size")
     
-    server = MoonshineWebSocketServer(args.host, args.port, args.model)
+    server = MoonshineWebSocketServer(args.host, args.port, args.model, args.udp_port, args.udp_loss,
+                                      args.encoder_workers, args.decoder_workers, args.pipeline_depth,
+                                      args.threads, args.spin_policy, args.max_sessions,
+                                      [p for p in args.peers.split(",") if p], args.migrate_secret,
+                                      args.rebalance_load, args.batch_size, args.batch_wait_ms, args.bucket_ms,
+                                      args.specialize, args.specialize_tolerance, args.trace_alloc,
+                                      args.encoder_threads, args.rebalance_lag_ms)
     asyncio.run(server.start())
 
 
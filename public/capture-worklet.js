@@ -0,0 +1,46 @@
+// Capture worklet: downsamples the capture stream to 16 kHz on the audio
+// rendering thread and posts fixed-size frames to a sink MessagePort (an
+// in-app engine, or the capture window's sender) as transferable buffers.
+// Nothing here touches the page's main thread, so UI work cannot delay audio.
+
+class CaptureProcessor extends AudioWorkletProcessor {
+  constructor(options) {
+    super();
+    const { targetRate = 16000, frameSamples = 1365 } = options.processorOptions || {};
+    this.ratio = sampleRate / targetRate;
+    this.frameSamples = frameSamples;
+    this.frame = new Float32Array(frameSamples);
+    this.filled = 0;
+    this.phase = 0;
+    this.sink = null;
+
+    this.port.onmessage = (event) => {
+      if (event.data.type === 'sink') {
+        this.sink = event.data.port;
+      } else if (event.data.type === 'stop') {
+        this.sink = null;
+      }
+    };
+  }
+
+  process(inputs) {
+    const input = inputs[0] && inputs[0][0];
+    if (!input || !this.sink) {
+      return true;
+    }
+
+    // Nearest-sample decimation, as in the ScriptProcessor path
+    for (; this.phase < input.length; this.phase += this.ratio) {
+      this.frame[this.filled++] = input[Math.floor(this.phase)];
+      if (this.filled === this.frameSamples) {
+        this.sink.postMessage(this.frame, [this.frame.buffer]);
+        this.frame = new Float32Array(this.frameSamples);
+        this.filled = 0;
+      }
+    }
+    this.phase -= input.length;
+    return true;
+  }
+}
+
+registerProcessor('capture-processor', CaptureProcessor);
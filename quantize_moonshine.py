@@ -0,0 +1,277 @@
+"""
+Quantized Moonshine variants for SubtitlesForAll
+
+Builds INT8 or INT4 versions of a Moonshine model's encoder and decoder
+graphs, then benchmarks them against the fp32 model on your own audio. This
+is the Moonshine counterpart of the whisper ``*-q5_1`` models.
+
+Usage:
+    python quantize_moonshine.py quantize --model moonshine/base --mode dynamic
+    python quantize_moonshine.py quantize --model moonshine/base --mode static --corpus recordings/
+    python quantize_moonshine.py quantize --model moonshine/tiny --mode int4
+    python quantize_moonshine.py report --model moonshine/base --corpus recordings/
+
+Modes:
+    dynamic   INT8 weights, activations quantized on the fly (MatMul/Gemm)
+    static    INT8 weights and activations (QDQ); the encoder is calibrated
+              on --corpus windows, the decoder (whose cache inputs cannot be
+              replayed from audio alone) is quantized dynamically
+    int4      4-bit block-quantized MatMul weights (MatMulNBits)
+
+Each variant is written to the server's model directory (see
+moonshine_server.py, e.g. ../models/moonshine/base-int8/). ONNX Runtime's
+graph fusions are applied and saved ahead of time, so a session does not
+have to redo them when it loads. The server lists the variant on the next
+start and loads it when a client requests "moonshine/base-int8".
+
+The corpus is a directory of 16 kHz mono 16-bit WAV files. A file with a
+transcript next to it (speech.wav + speech.txt) is also scored against that
+reference. Otherwise variants are scored against the fp32 model's output.
+The report prints as a table and can be saved as Markdown (--report) and
+JSON (--json).
+"""
+
+import argparse
+import json
+import shutil
+import sys
+import tempfile
+import time
+import wave
+from pathlib import Path
+
+import numpy as np
+
+SAMPLE_RATE = 16000
+WINDOW_SECONDS = 1.5  # the server's window length
+GRAPHS = ("encoder_model.onnx", "decoder_model_merged.onnx")
+MODES = {
+    "dynamic": ("int8", "INT8 dynamic"),
+    "static": ("int8-static", "INT8 static, calibrated"),
+    "int4": ("int4", "INT4 weights, block 32"),
+}
+
+
+def load_corpus(corpus: str, limit: int) -> list:
+    """[(name, audio, reference text or None)] for the WAV files in a directory."""
+    items = []
+    for path in sorted(Path(corpus).glob("*.wav"))[:limit]:
+        with wave.open(str(path), "rb") as wav:
+            if wav.getframerate() != SAMPLE_RATE or wav.getnchannels() != 1 or wav.getsampwidth() != 2:
+                print(f"Skipping {path.name}: expected 16 kHz mono 16-bit WAV")
+                continue
+            audio = np.frombuffer(wav.readframes(wav.getnframes()), dtype=np.int16).astype(np.float32) / 32768.0
+        reference = path.with_suffix(".txt")
+        items.append((path.name, audio, reference.read_text().strip() if reference.exists() else None))
+    if not items:
+        sys.exit(f"No usable WAV files in {corpus}")
+    return items
+
+
+def windows(audio: np.ndarray) -> list:
+    size = int(SAMPLE_RATE * WINDOW_SECONDS)
+    return [audio[i:i + size] for i in range(0, len(audio) - size // 3, size)]
+
+
+def fp32_graphs(model_name: str) -> dict:
+    """Paths of the published fp32 graphs (downloaded by moonshine-onnx if needed)."""
+    import moonshine_server
+    if not moonshine_server.MOONSHINE_AVAILABLE:
+        sys.exit("Moonshine ONNX is not installed: pip install useful-moonshine-onnx")
+    from moonshine_engine import graph_paths
+    encoder, decoder = graph_paths(moonshine_server.MoonshineOnnxModel, model_name)
+    return {GRAPHS[0]: Path(encoder), GRAPHS[1]: Path(decoder)}
+
+
+def optimize(source: Path, target: Path):
+    """Apply ORT's hardware-independent fusions and save the result."""
+    import onnxruntime as ort
+    options = ort.SessionOptions()
+    options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_EXTENDED
+    options.optimized_model_filepath = str(target)
+    ort.InferenceSession(str(source), options, providers=["CPUExecutionProvider"])
+
+
+class WindowReader:
+    """Calibration data for the encoder: one corpus window per call."""
+
+    def __init__(self, items: list, limit: int):
+        self.windows = iter([w[np.newaxis, :] for _, audio, _ in items for w in windows(audio)][:limit])
+
+    def get_next(self):
+        window = next(self.windows, None)
+        return None if window is None else {"input_values": window}
+
+
+def quantize_graph(mode: str, graph: str, source: Path, target: Path, items: list, calibration: int):
+    from onnxruntime.quantization import QuantFormat, QuantType, quantize_dynamic, quantize_static
+    from onnxruntime.quantization.shape_inference import quant_pre_process
+
+    with tempfile.TemporaryDirectory() as tmp:
+        prepared = Path(tmp) / "prepared.onnx"
+        quant_pre_process(str(source), str(prepared), skip_symbolic_shape=True)
+
+        if mode == "int4":
+            import onnx
+            try:
+                from onnxruntime.quantization.matmul_nbits_quantizer import MatMulNBitsQuantizer as Quantizer
+            except ImportError:
+                from onnxruntime.quantization.matmul_4bits_quantizer import MatMul4BitsQuantizer as Quantizer
+            quantizer = Quantizer(onnx.load(str(prepared)), block_size=32, is_symmetric=True)
+            quantizer.process()
+            quantized = Path(tmp) / "quantized.onnx"
+            quantizer.model.save_model_to_file(str(quantized), use_external_data_format=False)
+        elif mode == "static" and graph == GRAPHS[0]:
+            quantized = Path(tmp) / "quantized.onnx"
+            quantize_static(str(prepared), str(quantized), WindowReader(items, calibration),
+                            quant_format=QuantFormat.QDQ, per_channel=True,
+                            activation_type=QuantType.QInt8, weight_type=QuantType.QInt8)
+        else:
+            quantized = Path(tmp) / "quantized.onnx"
+            quantize_dynamic(str(prepared), str(quantized), weight_type=QuantType.QInt8,
+                             per_channel=True, op_types_to_quantize=["MatMul", "Gemm"])
+
+        optimize(quantized, target)
+
+
+def quantize(args):
+    import moonshine_server
+    suffix, description = MODES[args.mode]
+    size = args.model.split("/", 1)[-1]
+    name = f"{size}-{suffix}"
+    target = moonshine_server.MOONSHINE_DIR / name
+    if args.mode == "static" and not args.corpus:
+        sys.exit("--mode static needs --corpus for calibration")
+    items = load_corpus(args.corpus, args.files) if args.corpus else []
+
+    sources = fp32_graphs(args.model)
+    target.mkdir(parents=True, exist_ok=True)
+    for graph, source in sources.items():
+        started = time.perf_counter()
+        quantize_graph(args.mode, graph, source, target / graph, items, args.calibration)
+        print(f"{graph}: {source.stat().st_size / 1e6:.1f} MB -> {(target / graph).stat().st_size / 1e6:.1f} MB "
+              f"({time.perf_counter() - started:.0f} s)")
+    # The in-app engines read the tokenizer from the same directory
+    tokenizer = moonshine_server.MOONSHINE_DIR / size / "tokenizer.json"
+    if tokenizer.exists():
+        shutil.copy(tokenizer, target / "tokenizer.json")
+    (target / moonshine_server.VARIANT_INFO).write_text(json.dumps({
+        "source": args.model, "mode": args.mode, "description": description,
+        "calibration_windows": args.calibration if args.mode == "static" else 0,
+    }, indent=2))
+    print(f"Wrote moonshine/{name} to {target}")
+
+    if items:
+        args.variants = [f"moonshine/{name}"]
+        report(args)
+
+
+def run_model(model_name: str, items: list, threads: int) -> dict:
+    """Transcribe every corpus window; texts per file and per-window latencies."""
+    import moonshine_server
+    # Every model gets the same per-session pools, so pool sharing cannot skew the comparison
+    transcriber = moonshine_server.MoonshineTranscriber(model_name, threads, "hybrid", shared_pool=False)
+    if transcriber.model is None:
+        sys.exit(f"Could not load {model_name}")
+    texts, latencies, audio_seconds = {}, [], 0.0
+    for name, audio, _ in items:
+        parts = []
+        for window in windows(audio):
+            started = time.perf_counter()
+            parts.append(transcriber.transcribe(window))
+            latencies.append((time.perf_counter() - started) * 1000)
+            audio_seconds += len(window) / SAMPLE_RATE
+        texts[name] = parts
+    directory = moonshine_server.local_model_dir(model_name)
+    size = sum((directory / g).stat().st_size for g in GRAPHS) / 1e6 if directory else None
+    return {"texts": texts, "latencies": latencies, "audio_s": audio_seconds, "size_mb": size}
+
+
+def report(args):
+    import moonshine_server
+    from shadow_eval import normalise, word_errors
+    items = load_corpus(args.corpus, args.files)
+    size = args.model.split("/", 1)[-1]
+    variants = args.variants or [
+        f"moonshine/{p.parent.name}" for p in sorted(moonshine_server.MOONSHINE_DIR.glob(
+            f"{size}-*/{moonshine_server.VARIANT_INFO}"))]
+    results = {name: run_model(name, items, args.threads) for name in [args.model, *variants]}
+    baseline = results[args.model]["texts"]
+
+    rows = []
+    for name, result in results.items():
+        vs_fp32 = [0, 0]
+        vs_reference = [0, 0]
+        for file_name, _, reference in items:
+            for ours, theirs in zip(result["texts"][file_name], baseline[file_name]):
+                ref_words = normalise(theirs)
+                vs_fp32[0] += word_errors(ref_words, normalise(ours))
+                vs_fp32[1] += len(ref_words)
+            if reference:
+                ref_words = normalise(reference)
+                vs_reference[0] += word_errors(ref_words, normalise(" ".join(result["texts"][file_name])))
+                vs_reference[1] += len(ref_words)
+        latencies = result["latencies"]
+        rows.append({
+            "model": name,
+            "size_mb": round(result["size_mb"], 1) if result["size_mb"] else None,
+            "p50_ms": round(float(np.percentile(latencies, 50)), 1),
+            "p95_ms": round(float(np.percentile(latencies, 95)), 1),
+            "rtf": round(sum(latencies) / 1000 / result["audio_s"], 4),
+            "wer_vs_fp32": round(vs_fp32[0] / max(vs_fp32[1], 1), 4),
+            "wer_vs_reference": round(vs_reference[0] / vs_reference[1], 4) if vs_reference[1] else None,
+        })
+
+    fp32 = rows[0]
+    lines = [
+        f"# Moonshine quantization report: {args.model}",
+        "",
+        f"{len(items)} files, {sum(len(windows(a)) for _, a, _ in items)} windows of {WINDOW_SECONDS} s, "
+        f"{args.threads or 'auto'} threads",
+        "",
+        "| Model | Size (MB) | p50 (ms) | p95 (ms) | RTF | Speed-up | WER vs fp32 | WER vs reference |",
+        "|---|---|---|---|---|---|---|---|",
+    ]
+    for row in rows:
+        speedup = fp32["p50_ms"] / row["p50_ms"] if row["p50_ms"] else 0
+        reference = "-" if row["wer_vs_reference"] is None else f"{row['wer_vs_reference']:.1%}"
+        lines.append(f"| {row['model']} | {row['size_mb'] or '-'} | {row['p50_ms']} | {row['p95_ms']} | "
+                     f"{row['rtf']} | {speedup:.2f}x | {row['wer_vs_fp32']:.1%} | {reference} |")
+    text = "\n".join(lines)
+    print("\n" + text)
+    if args.report:
+        Path(args.report).write_text(text + "\n")
+    if args.json:
+        Path(args.json).write_text(json.dumps({"model": args.model, "rows": rows}, indent=2))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Quantized Moonshine variants and an accuracy/speed report")
+    sub = parser.add_subparsers(dest="command", required=True)
+    quantize_parser = sub.add_parser("quantize", help="Build a quantized variant (and report if --corpus is given)")
+    quantize_parser.add_argument("--mode", choices=list(MODES), default="dynamic")
+    quantize_parser.add_argument("--calibration", type=int, default=200,
+                                 help="Corpus windows used to calibrate static quantization")
+    report_parser = sub.add_parser("report", help="Benchmark variants against the fp32 model")
+    report_parser.add_argument("--variants", nargs="*", default=None,
+                               help="Variants to compare (default: every variant of --model on disk)")
+    for p in (quantize_parser, report_parser):
+        p.add_argument("--model", default="moonshine/base", help="Published model to start from")
+        p.add_argument("--corpus", default=None, help="Directory of 16 kHz mono WAV files (+ optional .txt)")
+        p.add_argument("--files", type=int, default=50, help="Use at most this many corpus files")
+        p.add_argument("--threads", type=int, default=0, help="Intra-op threads while benchmarking")
+        p.add_argument("--report", default=None, help="Also write the report as Markdown")
+        p.add_argument("--json", default=None, help="Also write the report as JSON")
+    args = parser.parse_args()
+
+    if args.command == "quantize":
+        args.variants = None
+        quantize(args)
+    else:
+        if not args.corpus:
+            parser.error("report needs --corpus")
+        report(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -15,6 +15,7 @@ Make sure whisper.cpp is built and the whisper-server binary is available.
 """
 
 import asyncio
+import io
 import json
 import struct
 import subprocess
@@ -22,7 +23,9 @@ import tempfile
 import wave
 import os
 import sys
+import time
 import argparse
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 
 try:
@@ -32,11 +35,58 @@ except ImportError:
     print("Please install required packages: pip install websockets numpy")
     sys.exit(1)
 
+from flow_control import AudioInbox
+from datagram_transport import DatagramAudioServer
+from caption_hub import CaptionHub
+from server_health import ServerHealth, chain_requests
+from heap_accounting import HeapAccounting, session_bytes
+from session_migration import SessionMigrator, MIGRATE_PATH
+from model_cascade import ModelCascade, DEFAULT_LOGPROB_THRESHOLD, DEFAULT_NO_SPEECH_THRESHOLD
+from shadow_eval import ShadowEvaluator, DEFAULT_FRACTION
+
 # Default configuration
 DEFAULT_PORT = 9090
 DEFAULT_HOST = "0.0.0.0"
 DEFAULT_MODEL = "models/ggml-base.en.bin"
 
+# Model names the app offers: name -> (file in ../models, decoder layers).
+# Turbo and distil checkpoints keep the large-v3 encoder but cut the decoder,
+# which runs once per token, to 4 or 2 layers. whisper.cpp reads the layer
+# count from the file, so they need nothing else from this server. Names
+# not listed here map to ggml-<name>.bin.
+WHISPER_MODELS = {
+    "tiny": ("ggml-tiny.bin", 4),
+    "tiny.en": ("ggml-tiny.en.bin", 4),
+    "tiny-q5_1": ("ggml-tiny-q5_1.bin", 4),
+    "base": ("ggml-base.bin", 6),
+    "base.en": ("ggml-base.en.bin", 6),
+    "base-q5_1": ("ggml-base-q5_1.bin", 6),
+    "small": ("ggml-small.bin", 12),
+    "small.en": ("ggml-small.en.bin", 12),
+    "medium": ("ggml-medium.bin", 24),
+    "medium.en": ("ggml-medium.en.bin", 24),
+    "large-v3": ("ggml-large-v3.bin", 32),
+    "large-v3-turbo": ("ggml-large-v3-turbo.bin", 4),
+    "large-v3-turbo-q5_0": ("ggml-large-v3-turbo-q5_0.bin", 4),
+    "large-v3-turbo-q8_0": ("ggml-large-v3-turbo-q8_0.bin", 4),
+    "distil-large-v3": ("ggml-distil-large-v3.bin", 2),
+    "distil-large-v3-q5_0": ("ggml-distil-large-v3-q5_0.bin", 2),
+    "distil-large-v3-q8_0": ("ggml-distil-large-v3-q8_0.bin", 2),
+}
+
+
+def model_name_from_path(path: str) -> str:
+    """App model name of a ggml file, e.g. models/ggml-base.en.bin -> base.en."""
+    name = Path(path).name
+    if name.endswith(".bin"):
+        name = name[:-len(".bin")]
+    return name.replace("ggml-", "", 1)
+
+
+def is_multilingual(model_name: str) -> bool:
+    """The .en models and the distil-whisper checkpoints only transcribe English."""
+    return ".en" not in model_name and not model_name.startswith("distil-")
+
 # Find whisper-server binary
 def find_whisper_server():
     """Find the whisper-server binary in common locations."""
@@ -55,6 +105,22 @@ def find_whisper_server():
     return None
 
 
+def pcm16(audio: np.ndarray) -> np.ndarray:
+    """Float samples in [-1, 1] to 16-bit PCM."""
+    return (audio * 32767).astype(np.int16)
+
+
+def pcm16_wav(audio: np.ndarray, sample_rate: int = 16000) -> bytes:
+    """A mono 16-bit WAV file, in memory."""
+    buffer = io.BytesIO()
+    with wave.open(buffer, 'wb') as wav_file:
+        wav_file.setnchannels(1)
+        wav_file.setsampwidth(2)  # 16-bit
+        wav_file.setframerate(sample_rate)
+        wav_file.writeframes(pcm16(audio).tobytes())
+    return buffer.getvalue()
+
+
 class WhisperTranscriber:
     """Handles audio transcription using whisper.cpp HTTP server or CLI."""
     
@@ -71,20 +137,16 @@ class WhisperTranscriber:
         # Map model names to file paths
         base_path = Path(__file__).parent.parent / "models"
         
-        # Handle quantized models with special naming
-        if model_name == "tiny-q5_1":
-            model_file = "ggml-tiny-q5_1.bin"
-        elif model_name == "base-q5_1":
-            model_file = "ggml-base-q5_1.bin"
-        else:
-            model_file = f"ggml-{model_name}.bin"
-        
+        model_file, layers = WHISPER_MODELS.get(model_name, (f"ggml-{model_name}.bin", None))
         model_path = base_path / model_file
         
         if model_path.exists():
             self.model_path = str(model_path)
             self.current_model_name = model_name
-            print(f"✓ Model set to: {model_file}")
+            details = [f"{layers} decoder layers"] if layers else []
+            if not is_multilingual(model_name):
+                details.append("English only")
+            print(f"✓ Model set to: {model_file}" + (f" ({', '.join(details)})" if details else ""))
             return str(model_path)
         else:
             print(f"⚠ Model file not found: {model_path}, using default")
@@ -94,41 +156,51 @@ class WhisperTranscriber:
         
     async def transcribe_audio(self, audio_data: np.ndarray) -> str:
         """Transcribe audio using whisper.cpp server."""
+        text, _ = await self.transcribe_with_confidence(audio_data)
+        return text
+
+    async def transcribe_with_confidence(self, audio_data: np.ndarray, prompt: str = None,
+                                         language: str = None):
+        """Transcribe audio and return (text, confidence).
+
+        prompt (the previous segment's text) and language are passed on to
+        whisper-server. confidence has "avg_logprob", "no_speech_prob" and the
+        detected "language"; each is None when the backend did not report it
+        (the CLI fallback reports none).
+        """
+        no_confidence = {"avg_logprob": None, "no_speech_prob": None, "language": None}
+        # English-only models (.en, distil-*) cannot take another language
+        if language and not is_multilingual(self.current_model_name or model_name_from_path(self.model_path)):
+            language = "en"
         try:
-            # Save audio to temporary WAV file
+            # Save audio to a temporary WAV file (the CLI fallback reads it)
+            audio_bytes = pcm16_wav(audio_data, self.sample_rate)
             with tempfile.NamedTemporaryFile(suffix=".wav", delete=False) as f:
                 temp_path = f.name
-                
-            # Write WAV file
-            with wave.open(temp_path, 'wb') as wav_file:
-                wav_file.setnchannels(1)
-                wav_file.setsampwidth(2)  # 16-bit
-                wav_file.setframerate(self.sample_rate)
-                
-                # Convert float32 to int16
-                audio_int16 = (audio_data * 32767).astype(np.int16)
-                wav_file.writeframes(audio_int16.tobytes())
+                f.write(audio_bytes)
             
             # Try to use the HTTP server first
             try:
                 import urllib.request
                 import urllib.parse
                 
-                with open(temp_path, 'rb') as f:
-                    audio_bytes = f.read()
-                
                 # Create multipart form data
                 boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW"
+                fields = {"response_format": "verbose_json"}
+                if prompt:
+                    fields["prompt"] = prompt
+                if language:
+                    fields["language"] = language
                 body = (
                     f"--{boundary}\r\n"
                     f'Content-Disposition: form-data; name="file"; filename="audio.wav"\r\n'
                     f"Content-Type: audio/wav\r\n\r\n"
-                ).encode() + audio_bytes + (
+                ).encode() + audio_bytes + "".join(
                     f"\r\n--{boundary}\r\n"
-                    f'Content-Disposition: form-data; name="response_format"\r\n\r\n'
-                    f"json\r\n"
-                    f"--{boundary}--\r\n"
-                ).encode()
+                    f'Content-Disposition: form-data; name="{name}"\r\n\r\n'
+                    f"{value}"
+                    for name, value in fields.items()
+                ).encode() + f"\r\n--{boundary}--\r\n".encode()
                 
                 req = urllib.request.Request(
                     f"{self.server_url}/inference",
@@ -138,18 +210,20 @@ class WhisperTranscriber:
                     }
                 )
                 
-                with urllib.request.urlopen(req, timeout=10) as response:
-                    result = json.loads(response.read().decode())
-                    return result.get("text", "")
+                # Run the blocking request off the event loop so other
+                # clients keep streaming (and receiving credit) meanwhile
+                loop = asyncio.get_running_loop()
+                result = await loop.run_in_executor(None, self._post_request, req)
+                return result.get("text", ""), self._confidence(result)
                     
             except Exception as e:
                 print(f"HTTP server not available, using CLI: {e}")
                 # Fallback to CLI
-                return await self._transcribe_cli(temp_path)
+                return await self._transcribe_cli(temp_path), no_confidence
                 
         except Exception as e:
             print(f"Transcription error: {e}")
-            return ""
+            return "", no_confidence
         finally:
             # Clean up temp file
             try:
@@ -157,6 +231,31 @@ class WhisperTranscriber:
             except:
                 pass
     
+    @staticmethod
+    def _confidence(result: dict) -> dict:
+        """Summarise the per-segment scores of a verbose_json reply."""
+        segments = result.get("segments") or []
+        logprobs = [s["avg_logprob"] for s in segments if "avg_logprob" in s]
+        if not logprobs:
+            # Older whisper-server builds only report per-token probabilities
+            probs = [t["p"] for s in segments for t in s.get("tokens", [])
+                     if isinstance(t, dict) and t.get("p")]
+            if probs:
+                logprobs = [float(np.mean(np.log(probs)))]
+        no_speech = [s["no_speech_prob"] for s in segments if "no_speech_prob" in s]
+        return {
+            "avg_logprob": float(np.mean(logprobs)) if logprobs else None,
+            "no_speech_prob": max(no_speech) if no_speech else None,
+            "language": result.get("language"),
+        }
+
+    @staticmethod
+    def _post_request(req) -> dict:
+        """Send an inference request to whisper-server and parse the JSON reply."""
+        import urllib.request
+        with urllib.request.urlopen(req, timeout=10) as response:
+            return json.loads(response.read().decode())
+
     async def _transcribe_cli(self, audio_path: str) -> str:
         """Transcribe using whisper.cpp CLI."""
         whisper_bin = find_whisper_server()
@@ -200,28 +299,76 @@ class WhisperTranscriber:
 class WebSocketServer:
     """WebSocket server that accepts audio and returns transcriptions."""
     
-    def __init__(self, host: str, port: int, model_path: str):
+    def __init__(self, host: str, port: int, model_path: str,
+                 udp_port: int = None, udp_loss: float = 0.0, cascade: ModelCascade = None,
+                 max_sessions: int = 0, peers=(), migrate_secret: str = None, rebalance_load: float = 0.0,
+                 shadow: ShadowEvaluator = None, trace_alloc: bool = False):
+        self.heap = HeapAccounting(trace_alloc)
         self.host = host
         self.port = port
         self.transcriber = WhisperTranscriber(model_path)
         self.clients = set()
+        self.udp_port = udp_port
+        self.datagram = DatagramAudioServer(loss=udp_loss) if udp_port is not None else None
+        self.hub = CaptionHub()
+        self.cascade = cascade
+        self.shadow = shadow
+        # Background work that only runs while no live decode is in flight
+        self.idle_work = [w.queue for w in (cascade, shadow) if w]
+        # whisper-server decodes one request at a time
+        self.health = ServerHealth("whisper", lambda: Path(self.transcriber.model_path).stem,
+                                   workers=1, max_sessions=max_sessions)
+        self.migrator = SessionMigrator("whisper", self.health, peers, migrate_secret, rebalance_load)
         
     async def handle_client(self, websocket):
         """Handle a WebSocket client connection."""
         client_id = id(websocket)
+        
+        # Read-only caption viewers connect on /subscribe/<channel>
+        channel = self.hub.channel_from_path(websocket.request.path)
+        if channel:
+            await self.hub.subscribe(websocket, channel)
+            return
+        
+        # A peer handing over a session (session_migration.py)
+        if websocket.request.path == MIGRATE_PATH:
+            await self.migrator.receive(websocket)
+            return
+        
+        # Full or draining: the client fails over to another server
+        if not self.health.accepting():
+            await websocket.close(1013, self.health.snapshot()["status"])
+            return
+        
         self.clients.add(websocket)
         print(f"Client {client_id} connected. Total clients: {len(self.clients)}")
         
-        audio_buffer = []
-        config = {}
+        inbox = AudioInbox()
+        self.health.session_started(websocket, inbox)
         current_model = None
+        datagram_token = None
+        # Everything a migration needs to carry over lives here
+        session = {
+            "channel": None,
+            "cascade": self.cascade is not None,
+            "config": {},
+            "audio": [],           # received, not yet transcribed (plus the overlap)
+            "segment_id": 0,
+            "stream_samples": 0,
+            "prompt": None,        # previous segment's text, passed to whisper-server
+            "language": None,      # requested, or locked to the first detected language
+            "migrating": False,
+        }
+        self.heap.session_started(websocket, lambda: session_bytes(session, inbox, websocket))
+        processor = asyncio.create_task(self.process_audio(websocket, inbox, session))
+        self.migrator.register(websocket, session, inbox, processor)
         
         try:
             # Send server ready message
-            await websocket.send(json.dumps({
-                "message": "SERVER_READY",
-                "status": "ready"
-            }))
+            ready = {"message": "SERVER_READY", "status": "ready", **inbox.ready_fields()}
+            if self.cascade:
+                ready["cascade"] = {"model": self.cascade.model_name}
+            await websocket.send(json.dumps(ready))
             
             async for message in websocket:
                 if isinstance(message, str):
@@ -230,6 +377,26 @@ class WebSocketServer:
                         config = json.loads(message)
                         print(f"Client {client_id} config: {config}")
                         
+                        # A language change from the client replaces any lock
+                        if config.get('language') != session["config"].get('language'):
+                            session["language"] = config.get('language')
+                        session["config"] = config
+                        
+                        # Session moved here from another server
+                        if config.get('resume'):
+                            state = self.migrator.claim(config['resume'])
+                            if state:
+                                session["language"] = state["language"]
+                                session["prompt"] = state["prompt"]
+                                session["segment_id"] = state["segment_id"]
+                                session["stream_samples"] += state["stream_samples"]
+                                session["audio"] = [state["audio"], *session["audio"]]
+                                print(f"Client {client_id} resumed a migrated session at segment {state['segment_id']}")
+                            await websocket.send(json.dumps({
+                                "type": "resumed" if state else "resume_failed",
+                                "segment_id": session["segment_id"],
+                            }))
+                        
                         # Handle model change request
                         if 'model' in config and config['model'] != current_model:
                             requested_model = config['model']
@@ -262,75 +429,199 @@ class WebSocketServer:
                                 "model": requested_model,
                                 "progress": 100
                             }))
+                        
+                        # Audio over UDP datagrams, results stay on this socket
+                        if config.get('transport') == 'datagram' and self.datagram and not datagram_token:
+                            transport = self.datagram.register(inbox)
+                            datagram_token = transport["token"]
+                            await websocket.send(json.dumps(transport))
+                        
+                        # Publish this session's captions to read-only viewers
+                        if config.get('publish') and not session["channel"]:
+                            reply = self.hub.start_publishing(config['publish'])
+                            if reply:
+                                if reply["type"] == "publishing":
+                                    session["channel"] = config['publish']
+                                await websocket.send(json.dumps(reply))
+                        
+                        # Clients may opt out of cascade corrections
+                        if 'cascade' in config:
+                            session["cascade"] = self.cascade is not None and bool(config['cascade'])
                             
                     except json.JSONDecodeError:
                         pass
                         
                 elif isinstance(message, bytes):
-                    # Binary audio data (Float32Array)
-                    try:
-                        # Parse as float32 array
-                        audio_chunk = np.frombuffer(message, dtype=np.float32)
-                        audio_buffer.append(audio_chunk)
-                        
-                        # Process when we have enough audio
-                        total_samples = sum(len(chunk) for chunk in audio_buffer)
-                        duration = total_samples / 16000  # Assuming 16kHz
-                        
-                        if duration >= 2.0:  # Process every 2 seconds
-                            # Combine all audio chunks
-                            full_audio = np.concatenate(audio_buffer)
-                            
-                            # Transcribe
-                            text = await self.transcriber.transcribe_audio(full_audio)
-                            
-                            if text.strip():
-                                # Send transcription result
-                                result = {
-                                    "segments": [
-                                        {
-                                            "id": 0,
-                                            "text": text.strip(),
-                                            "start": 0,
-                                            "end": duration
-                                        }
-                                    ]
-                                }
-                                await websocket.send(json.dumps(result))
-                            
-                            # Keep last 0.5 seconds for context overlap
-                            keep_samples = int(16000 * 0.5)
-                            if len(full_audio) > keep_samples:
-                                audio_buffer = [full_audio[-keep_samples:]]
-                            else:
-                                audio_buffer = []
-                                
-                    except Exception as e:
-                        print(f"Error processing audio: {e}")
+                    # Binary audio data (Float32Array), transcribed by process_audio
+                    inbox.put(np.frombuffer(message, dtype=np.float32))
                         
         except websockets.exceptions.ConnectionClosed:
             print(f"Client {client_id} disconnected")
         except Exception as e:
             print(f"Error with client {client_id}: {e}")
         finally:
+            processor.cancel()
+            if self.cascade:
+                self.cascade.discard(session)
+            if inbox.overruns:
+                print(f"Client {client_id} sent {inbox.overruns} frames beyond its credit")
+            if datagram_token:
+                print(f"Client {client_id} datagram stats: {self.datagram.unregister(datagram_token)}")
+            if session["channel"]:
+                self.hub.stop_publishing(session["channel"])
+            self.health.session_ended(websocket)
+            self.heap.session_ended(websocket)
+            self.migrator.unregister(websocket)
             self.clients.discard(websocket)
             print(f"Client {client_id} removed. Total clients: {len(self.clients)}")
+
+    async def process_audio(self, websocket, inbox: AudioInbox, session: dict):
+        """Transcribe queued audio in 2 second windows, returning credit as frames are taken.
+
+        All state lives in session so a migration can carry it to a peer.
+        """
+        async def deliver_revision(segment: dict):
+            await websocket.send(json.dumps({
+                "type": "segment_revision",
+                "model": self.cascade.model_name,
+                "segments": [segment],
+            }))
+            if session["channel"]:
+                self.hub.publish(session["channel"], segment)
+        
+        try:
+            while True:
+                frames = await inbox.get_batch()
+                await websocket.send(inbox.credit_message())
+                session["stream_samples"] += sum(len(f) for f in frames)
+                session["audio"].extend(frames)
+                if session["migrating"]:
+                    return  # the rest goes to a peer (session_migration.py)
+                
+                try:
+                    # Process when we have enough audio
+                    total_samples = sum(len(chunk) for chunk in session["audio"])
+                    duration = total_samples / 16000  # Assuming 16kHz
+                    
+                    if duration >= 2.0:  # Process every 2 seconds
+                        # Combine all audio chunks
+                        full_audio = np.concatenate(session["audio"])
+                        
+                        # Transcribe (cascade and shadow jobs wait while this runs)
+                        for work in self.idle_work:
+                            work.live_started()
+                        started = time.perf_counter()
+                        prompt = session["prompt"]
+                        try:
+                            text, confidence = await self.transcriber.transcribe_with_confidence(
+                                full_audio, prompt, session["language"])
+                        finally:
+                            for work in self.idle_work:
+                                work.live_finished()
+                        elapsed = time.perf_counter() - started
+                        self.health.record(duration, elapsed)
+                        if self.shadow:
+                            self.shadow.offer(full_audio, text, elapsed, session["language"])
+                        
+                        # Auto-detect once, then keep the language for the rest of the session
+                        if session["language"] is None and confidence["language"]:
+                            session["language"] = confidence["language"]
+                        
+                        if text.strip():
+                            # Send transcription result (times are seconds since session start)
+                            end = session["stream_samples"] / 16000
+                            segment = {
+                                "id": session["segment_id"],
+                                "rev": 0,
+                                "text": text.strip(),
+                                "start": round(end - duration, 3),
+                                "end": round(end, 3)
+                            }
+                            session["segment_id"] += 1
+                            session["prompt"] = segment["text"]
+                            await websocket.send(json.dumps({"segments": [segment]}))
+                            if session["channel"]:
+                                self.hub.publish(session["channel"], segment)
+                            
+                            # Low-confidence window: have the larger model take another look
+                            if session["cascade"] and self.cascade.needs_escalation(confidence):
+                                self.cascade.submit(session, full_audio, segment, deliver_revision,
+                                                    session["language"], prompt)
+                        
+                        # Keep last 0.5 seconds for context overlap
+                        keep_samples = int(16000 * 0.5)
+                        if len(full_audio) > keep_samples:
+                            session["audio"] = [full_audio[-keep_samples:]]
+                        else:
+                            session["audio"] = []
+                            
+                except websockets.exceptions.ConnectionClosed:
+                    raise
+                except Exception as e:
+                    print(f"Error processing audio: {e}")
+        except websockets.exceptions.ConnectionClosed:
+            pass
     
     async def start(self):
         """Start the WebSocket server."""
         print(f"Starting WhisperLive-compatible server on ws://{self.host}:{self.port}")
         print(f"Using model: {self.transcriber.model_path}")
         
+        if self.datagram:
+            await self.datagram.start(self.host, self.udp_port)
+        
+        if self.cascade:
+            print(f"Cascade: low-confidence windows re-decoded by {self.cascade.model_name} "
+                  f"({self.cascade.transcriber.server_url})")
+            asyncio.create_task(self.cascade.run())
+        
+        if self.shadow:
+            print(f"Shadow: {self.shadow.fraction:.0%} of windows mirrored to {self.shadow.model_name}; "
+                  f"results on http://{self.host}:{self.port}/shadow")
+            asyncio.create_task(self.shadow.run())
+        
+        self.migrator.start()
+        if self.migrator.peers:
+            print(f"Session migration peers: {', '.join(self.migrator.peers)}")
+        
         async with websockets.serve(
             self.handle_client,
             self.host,
             self.port,
             ping_interval=30,
             ping_timeout=10,
-            max_size=10 * 1024 * 1024  # 10MB max message size
+            max_size=10 * 1024 * 1024,  # 10MB max message size
+            # /health for client server selection, /drain to hand sessions to peers,
+            # /shadow for the candidate model's scores, /overlay/<channel> for viewers,
+            # /metrics for memory per session and stage
+            process_request=chain_requests(self.health.process_request, self.migrator.process_request,
+                                           *([self.shadow.process_request] if self.shadow else []),
+                                           self.hub.process_request, self.heap.process_request),
         ):
             print("Server started. Waiting for connections...")
-            await asyncio.Future()  # Run forever
+            await self.migrator.stopped.wait()  # Until drained
+
+
+def shadow_transcribe(model: str, server_url: str):
+    """transcribe(audio, language) coroutine for a shadow candidate model."""
+    if model.startswith("moonshine/"):
+        # In-process, on its own thread so the event loop stays free
+        from moonshine_server import MoonshineTranscriber
+        transcriber = MoonshineTranscriber(model)
+        pool = ThreadPoolExecutor(1, thread_name_prefix="shadow")
+        
+        async def transcribe(audio, language):
+            return await asyncio.get_running_loop().run_in_executor(pool, transcriber.transcribe, audio)
+        return transcribe
+    
+    transcriber = WhisperTranscriber(model, server_url=server_url)
+    if not Path(model).exists():
+        transcriber.set_model(model)
+    
+    async def transcribe(audio, language):
+        text, _ = await transcriber.transcribe_with_confidence(audio, None, language)
+        return text
+    return transcribe
 
 
 def main():
@@ -339,6 +630,34 @@ def main():
     parser.add_argument("--port", type=int, default=DEFAULT_PORT, help="Port to listen on")
     parser.add_argument("--model", "-m", default=DEFAULT_MODEL, help="Path to whisper.cpp model")
     parser.add_argument("--backend", default="whisper_cpp", help="Backend to use (ignored, always uses whisper.cpp)")
+    parser.add_argument("--udp-port", type=int, default=None,
+                        help="Also accept audio as UDP datagrams with FEC on this port")
+    parser.add_argument("--udp-loss", type=float, default=0.0,
+                        help="Simulated datagram loss (0-1) for testing")
+    parser.add_argument("--cascade-model", default=None,
+                        help="Larger model (name or path) that re-decodes low-confidence windows, e.g. small")
+    parser.add_argument("--cascade-server-url", default="http://127.0.0.1:8081",
+                        help="whisper-server instance running the cascade model")
+    parser.add_argument("--cascade-logprob", type=float, default=DEFAULT_LOGPROB_THRESHOLD,
+                        help="Re-decode windows whose average log-probability is below this")
+    parser.add_argument("--cascade-no-speech", type=float, default=DEFAULT_NO_SPEECH_THRESHOLD,
+                        help="Re-decode windows whose no-speech probability is above this")
+    parser.add_argument("--max-sessions", type=int, default=0,
+                        help="Refuse new capture sessions beyond this many (0 = no limit)")
+    parser.add_argument("--peers", default="",
+                        help="Comma-separated servers to migrate sessions to when draining, e.g. ws://host2:9090")
+    parser.add_argument("--migrate-secret", default=os.environ.get("SFA_MIGRATE_SECRET"),
+                        help="Shared secret peers must present to hand over sessions (default: $SFA_MIGRATE_SECRET)")
+    parser.add_argument("--rebalance-load", type=float, default=0.0,
+                        help="Move sessions to a peer while load stays above this (0 = off)")
+    parser.add_argument("--shadow-model", default=None,
+                        help="Candidate model to score on live windows, e.g. base-q5_1 or moonshine/base")
+    parser.add_argument("--shadow-server-url", default="http://127.0.0.1:8082",
+                        help="whisper-server instance running a whisper candidate model")
+    parser.add_argument("--shadow-fraction", type=float, default=DEFAULT_FRACTION,
+                        help="Share of live windows mirrored to the candidate")
+    parser.add_argument("--trace-alloc", action="store_true",
+                        help="Trace Python allocations and report them per pipeline stage on /metrics (slower)")
     
     args = parser.parse_args()
     
@@ -351,7 +670,24 @@ def main():
         print(f"Warning: Model not found at {model_path}")
         print("Please download a model using: ./models/download-ggml-model.sh base.en")
     
-    server = WebSocketServer(args.host, args.port, str(model_path))
+    cascade = None
+    if args.cascade_model:
+        cascade_transcriber = WhisperTranscriber(args.cascade_model, server_url=args.cascade_server_url)
+        if not Path(args.cascade_model).exists():
+            cascade_transcriber.set_model(args.cascade_model)
+        cascade = ModelCascade(cascade_transcriber, model_name_from_path(args.cascade_model),
+                               args.cascade_logprob, args.cascade_no_speech)
+    
+    shadow = None
+    if args.shadow_model:
+        shadow = ShadowEvaluator(shadow_transcribe(args.shadow_model, args.shadow_server_url),
+                                 args.shadow_model, None, args.shadow_fraction)
+    
+    server = WebSocketServer(args.host, args.port, str(model_path), args.udp_port, args.udp_loss, cascade,
+                             args.max_sessions, [p for p in args.peers.split(",") if p],
+                             args.migrate_secret, args.rebalance_load, shadow, args.trace_alloc)
+    if shadow:
+        shadow.primary_name = server.health.model_name
     
     try:
         asyncio.run(server.start())
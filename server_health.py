@@ -0,0 +1,120 @@
+"""
+Health and load telemetry for the SubtitlesForAll WebSocket servers
+
+Clients with several servers configured probe each one and connect to the
+least-loaded server that answers. Probes are plain HTTP on the WebSocket
+port:
+
+    GET http://<server>/health
+
+    {"status": "ok", "backend": "whisper", "model": "base.en",
+     "sessions": 3, "max_sessions": 8, "workers": 1,
+     "rtf": 0.21, "load": 0.63, "queue_ms": 340, "max_lag_ms": 180}
+
+``rtf`` is a moving average of compute time per second of audio. ``load``
+estimates how busy the inference workers are: the compute the current
+sessions need divided by the workers available. Above 1 the server is
+falling behind. ``status`` is "full" at ``max_sessions`` and "draining"
+while the server is shutting down. Clients should not pick a server in
+either state.
+"""
+
+import json
+import time
+from http import HTTPStatus
+
+from websockets.datastructures import Headers
+from websockets.http11 import Response
+
+HEALTH_PATH = "/health"
+RTF_SMOOTHING = 0.2  # weight of the newest window in the moving average
+
+
+class ServerHealth:
+    """Session count, queue depth and real-time factor of one server."""
+
+    def __init__(self, backend: str, model_name=None, workers: int = 1, max_sessions: int = 0):
+        self.backend = backend
+        self.model_name = model_name  # callable or str
+        self.workers = max(workers, 1)
+        self.max_sessions = max_sessions
+        self.sessions = {}  # key -> AudioInbox
+        self.rtf = 0.0
+        self.windows = 0
+        self.draining = False
+        self.started = time.time()
+
+    def session_started(self, key, inbox):
+        self.sessions[key] = inbox
+
+    def session_ended(self, key):
+        self.sessions.pop(key, None)
+
+    def accepting(self) -> bool:
+        if self.draining:
+            return False
+        return not self.max_sessions or len(self.sessions) < self.max_sessions
+
+    def record(self, audio_seconds: float, compute_seconds: float):
+        """Fold one transcribed window into the RTF average."""
+        if audio_seconds <= 0:
+            return
+        rtf = compute_seconds / audio_seconds
+        self.rtf = rtf if not self.windows else self.rtf + RTF_SMOOTHING * (rtf - self.rtf)
+        self.windows += 1
+
+    @property
+    def load(self) -> float:
+        return self.rtf * len(self.sessions) / self.workers
+
+    @property
+    def max_lag_ms(self) -> int:
+        """Queued audio of the session furthest behind."""
+        return max((inbox.queue_ms for inbox in self.sessions.values()), default=0)
+
+    def snapshot(self) -> dict:
+        queues = [inbox.queue_ms for inbox in self.sessions.values()]
+        if self.draining:
+            status = "draining"
+        elif not self.accepting():
+            status = "full"
+        else:
+            status = "ok"
+        model = self.model_name() if callable(self.model_name) else self.model_name
+        return {
+            "status": status,
+            "backend": self.backend,
+            "model": model,
+            "sessions": len(self.sessions),
+            "max_sessions": self.max_sessions,
+            "workers": self.workers,
+            "rtf": round(self.rtf, 3),
+            "load": round(self.load, 3),
+            "queue_ms": sum(queues),
+            "max_lag_ms": max(queues, default=0),
+            "uptime": int(time.time() - self.started),
+        }
+
+    def process_request(self, connection, request):
+        """websockets hook: answer GET /health with the snapshot."""
+        if request.path.split("?", 1)[0] != HEALTH_PATH:
+            return None
+        body = json.dumps(self.snapshot()).encode()
+        headers = Headers([
+            ("Content-Type", "application/json"),
+            ("Content-Length", str(len(body))),
+            ("Cache-Control", "no-cache"),
+            ("Access-Control-Allow-Origin", "*"),
+        ])
+        return Response(HTTPStatus.OK.value, HTTPStatus.OK.phrase, headers, body)
+
+
+def chain_requests(*hooks):
+    """Combine process_request hooks; the first one that answers wins."""
+    def process_request(connection, request):
+        for hook in hooks:
+            response = hook(connection, request)
+            if response is not None:
+                return response
+        return None
+    return process_request
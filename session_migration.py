@@ -0,0 +1,311 @@
+"""
+Live session migration between SubtitlesForAll servers (shards)
+
+A server that is draining for a restart or running over its load limit
+moves capture sessions to a peer instead of dropping them:
+
+    1. The session is paused and its state is serialised. That covers the
+       config, the locked language, the prompt (text of the last segment),
+       the next segment id, the stream clock, the publish channel, and the
+       audio that was received but not yet transcribed.
+    2. The state is pushed to the peer over a WebSocket on /migrate:
+
+           server -> peer    {"type": "migrate_session", "secret": ..., "state": {...}}
+           peer -> server    {"type": "migrate_accepted", "token": "..."}
+
+    3. The client is redirected and the old connection closed (1012):
+
+           server -> client  {"type": "migrate", "url": "ws://peer:9090", "resume": "..."}
+
+    4. The client connects to the peer and sends its config with
+       "resume": token. The peer restores the state. Segment ids and
+       timestamps continue, and the unflushed audio is transcribed first:
+
+           peer -> client    {"type": "resumed", "segment_id": 42}
+
+The peer keeps the state for RESUME_TTL seconds. A client that never comes
+back simply starts fresh wherever it reconnects.
+
+/migrate hands out resume tokens for whatever state it is given, so it is
+guarded: with a shared secret, pushes must carry it; without one, /migrate
+is only accepted from this machine and from the configured peers' addresses.
+
+Draining starts on SIGTERM (where the platform has signals) or on
+GET /drain from the server's own machine with an X-Migrate-Secret header:
+the secret when one is set, any value otherwise. Browsers cannot add that
+header to a cross-origin request, so a web page cannot drain the server. With --rebalance-load, a server
+whose load (see server_health.py) stays above the limit moves its newest
+session to a peer with room; with --rebalance-lag-ms, so does a server whose
+worst session lags by more than that.
+"""
+
+import asyncio
+import base64
+import hmac
+import json
+import secrets
+import signal
+import socket
+import time
+import urllib.request
+from http import HTTPStatus
+from urllib.parse import urlsplit
+
+import numpy as np
+import websockets
+
+MIGRATE_PATH = "/migrate"
+DRAIN_PATH = "/drain"
+RESUME_TTL = 30.0
+PAUSE_TIMEOUT = 1.5  # wait this long for an in-flight window before cutting it off
+REBALANCE_INTERVAL = 5.0
+PROBE_TIMEOUT = 2.0
+LOOPBACK = ("127.0.0.1", "::1", "localhost")
+SECRET_HEADER = "X-Migrate-Secret"
+
+
+def plain_address(address: str) -> str:
+    """The IPv4 address inside an IPv4-mapped IPv6 one (dual-stack sockets)."""
+    return address.removeprefix("::ffff:")
+
+
+def is_loopback(address: str) -> bool:
+    return plain_address(address) in LOOPBACK
+
+
+def encode_audio(chunks: list) -> str:
+    audio = np.concatenate(chunks).astype(np.float32) if chunks else np.zeros(0, np.float32)
+    return base64.b64encode(audio.tobytes()).decode("ascii")
+
+
+def decode_audio(data: str) -> np.ndarray:
+    return np.frombuffer(base64.b64decode(data), dtype=np.float32).copy()
+
+
+def health_url(server_url: str) -> str:
+    scheme, rest = server_url.split("://", 1)
+    return f"{'https' if scheme == 'wss' else 'http'}://{rest.split('/', 1)[0]}/health"
+
+
+def peer_addresses(peers) -> set:
+    """IP addresses the peer URLs resolve to (unresolvable ones are skipped)."""
+    addresses = set()
+    for peer in peers:
+        host = urlsplit(peer).hostname
+        try:
+            addresses.update(info[4][0] for info in socket.getaddrinfo(host, None))
+        except (socket.gaierror, UnicodeError, TypeError):
+            print(f"⚠ Could not resolve peer {peer}")
+    return addresses
+
+
+def _get_json(url: str) -> dict:
+    with urllib.request.urlopen(url, timeout=PROBE_TIMEOUT) as response:
+        return json.loads(response.read())
+
+
+class SessionMigrator:
+    """Moves sessions to peers and takes sessions in from them."""
+
+    def __init__(self, backend: str, health, peers=(), secret: str = None, rebalance_load: float = 0.0,
+                 rebalance_lag_ms: int = 0):
+        self.backend = backend
+        self.health = health
+        self.peers = [p.rstrip("/") for p in peers]
+        self.secret = secret
+        self.rebalance_load = rebalance_load
+        self.rebalance_lag_ms = rebalance_lag_ms
+        # Without a secret, only these may push sessions in
+        self.trusted = set(LOOPBACK) if secret else set(LOOPBACK) | peer_addresses(self.peers)
+        self.sessions = {}   # websocket -> (session, inbox, processor task)
+        self.resumable = {}  # token -> (expires, state)
+        self.stopped = asyncio.Event()
+        self.stats = {"sent": 0, "received": 0, "resumed": 0, "failed": 0}
+
+    # -- sessions on this server ---------------------------------------------
+
+    def register(self, websocket, session: dict, inbox, processor):
+        self.sessions[websocket] = (session, inbox, processor)
+
+    def unregister(self, websocket):
+        self.sessions.pop(websocket, None)
+
+    def snapshot(self, session: dict, inbox) -> dict:
+        """Serialise a paused session, including audio still in its inbox."""
+        frames = inbox.take_all()
+        session["stream_samples"] += sum(len(f) for f in frames)
+        audio = session["audio"]
+        chunks = (list(audio) if isinstance(audio, list) else [audio]) + frames
+        return {
+            "backend": self.backend,
+            "config": session["config"],
+            "language": session.get("language"),
+            "prompt": session.get("prompt"),
+            "segment_id": session["segment_id"],
+            "stream_samples": session["stream_samples"],
+            "channel": session.get("channel"),
+            "audio": encode_audio(chunks),
+            "audio_samples": sum(len(c) for c in chunks),
+        }
+
+    # -- taking sessions in ----------------------------------------------------
+
+    def accepts_from(self, address: str) -> bool:
+        """Whether a push from this address may proceed to the secret check."""
+        if self.secret:
+            return True
+        return plain_address(address) in self.trusted
+
+    async def receive(self, websocket):
+        """Handle a peer pushing a session on /migrate."""
+        if not self.accepts_from(websocket.remote_address[0]):
+            await websocket.close(1008, "forbidden")
+            return
+        try:
+            message = json.loads(await websocket.recv())
+            state = message.get("state") or {}
+            if self.secret and not hmac.compare_digest(str(message.get("secret", "")), self.secret):
+                reason = "bad secret"
+            elif state.get("backend") != self.backend:
+                reason = f"backend {state.get('backend')} != {self.backend}"
+            elif not self.health.accepting():
+                reason = "not accepting sessions"
+            else:
+                reason = None
+            if reason:
+                await websocket.send(json.dumps({"type": "migrate_rejected", "reason": reason}))
+                return
+            self._expire()
+            token = secrets.token_urlsafe(16)
+            self.resumable[token] = (time.monotonic() + RESUME_TTL, state)
+            self.stats["received"] += 1
+            await websocket.send(json.dumps({"type": "migrate_accepted", "token": token}))
+        except (websockets.exceptions.ConnectionClosed, json.JSONDecodeError) as e:
+            print(f"Migration from peer failed: {e}")
+
+    def claim(self, token: str):
+        """State for a resume token (once), with the audio decoded; None if unknown or expired."""
+        self._expire()
+        entry = self.resumable.pop(token, None)
+        if entry is None:
+            return None
+        state = dict(entry[1])
+        state["audio"] = decode_audio(state.get("audio", ""))
+        self.stats["resumed"] += 1
+        return state
+
+    def _expire(self):
+        now = time.monotonic()
+        for token in [t for t, (expires, _) in self.resumable.items() if expires < now]:
+            del self.resumable[token]
+
+    # -- moving sessions out ---------------------------------------------------
+
+    async def probe_peers(self) -> list:
+        """(load, url) for every peer that is taking sessions, least loaded first."""
+        results = await asyncio.gather(*(asyncio.to_thread(_get_json, health_url(p)) for p in self.peers),
+                                       return_exceptions=True)
+        return sorted((r["load"], p) for p, r in zip(self.peers, results)
+                      if isinstance(r, dict) and r.get("status") == "ok")
+
+    async def push(self, peer: str, state: dict) -> str:
+        async with websockets.connect(peer + MIGRATE_PATH, max_size=10 * 1024 * 1024) as ws:
+            await ws.send(json.dumps({"type": "migrate_session", "secret": self.secret, "state": state}))
+            reply = json.loads(await asyncio.wait_for(ws.recv(), PROBE_TIMEOUT))
+        if reply.get("type") != "migrate_accepted":
+            raise RuntimeError(reply.get("reason", "rejected"))
+        return reply["token"]
+
+    async def migrate(self, websocket, peer: str) -> bool:
+        """Pause one session, hand it to peer and redirect the client there."""
+        entry = self.sessions.get(websocket)
+        if entry is None:
+            return False
+        session, inbox, processor = entry
+        started = time.perf_counter()
+
+        # The transcription loop returns at its next batch once it sees this
+        session["migrating"] = True
+        inbox.wake()
+        done, _ = await asyncio.wait([processor], timeout=PAUSE_TIMEOUT)
+        if not done:
+            processor.cancel()
+        state = self.snapshot(session, inbox)
+
+        try:
+            token = await self.push(peer, state)
+            await websocket.send(json.dumps({"type": "migrate", "url": peer, "resume": token}))
+            self.stats["sent"] += 1
+            print(f"Migrated session to {peer} in {(time.perf_counter() - started) * 1000:.0f} ms "
+                  f"({state['audio_samples'] / 16000:.2f} s of unflushed audio)")
+            return True
+        except Exception as e:
+            # The client fails over by itself; only the unflushed audio is lost
+            self.stats["failed"] += 1
+            print(f"Migration to {peer} failed: {e}")
+            return False
+        finally:
+            await websocket.close(1012, "migrated")
+
+    async def drain(self):
+        """Stop taking sessions, move every session to peers, then stop the server."""
+        if self.health.draining:
+            return
+        self.health.draining = True
+        print(f"Draining {len(self.sessions)} session(s) to {len(self.peers)} peer(s)...")
+        peers = await self.probe_peers() if self.peers else []
+        moves = []
+        for i, websocket in enumerate(list(self.sessions)):
+            if peers:
+                # Spread the sessions over the peers, least loaded first
+                moves.append(self.migrate(websocket, peers[i % len(peers)][1]))
+            else:
+                moves.append(websocket.close(1012, "draining"))
+        await asyncio.gather(*moves, return_exceptions=True)
+        print(f"Drained. Migration stats: {self.stats}")
+        self.stopped.set()
+
+    async def rebalance(self):
+        """Move the newest session to a peer while this server is over its load limit."""
+        while True:
+            await asyncio.sleep(REBALANCE_INTERVAL)
+            overloaded = 0 < self.rebalance_load < self.health.load
+            lagging = 0 < self.rebalance_lag_ms < self.health.max_lag_ms
+            if self.health.draining or not (overloaded or lagging) or len(self.sessions) < 2:
+                continue
+            room = (self.rebalance_load or 1.0) / 2
+            peers = [(load, p) for load, p in await self.probe_peers() if load < room]
+            if peers:
+                print(f"Load {self.health.load:.2f}, lag {self.health.max_lag_ms} ms; "
+                      f"moving a session to {peers[0][1]}")
+                await self.migrate(list(self.sessions)[-1], peers[0][1])
+
+    # -- triggers --------------------------------------------------------------
+
+    def process_request(self, connection, request):
+        """websockets hook: GET /drain from this machine (with the header) starts draining; guards /migrate."""
+        path = request.path.split("?", 1)[0]
+        if path == MIGRATE_PATH:
+            if not self.accepts_from(connection.remote_address[0]):
+                return connection.respond(HTTPStatus.FORBIDDEN, "Forbidden\n")
+            return None
+        if path != DRAIN_PATH:
+            return None
+        presented = request.headers.get(SECRET_HEADER)
+        if (not is_loopback(connection.remote_address[0]) or presented is None
+                or (self.secret and not hmac.compare_digest(presented, self.secret))):
+            return connection.respond(HTTPStatus.FORBIDDEN, "Forbidden\n")
+        asyncio.get_running_loop().create_task(self.drain())
+        return connection.respond(HTTPStatus.ACCEPTED, "Draining\n")
+
+    def start(self):
+        """Install the SIGTERM handler and the rebalance loop (call from the running loop)."""
+        loop = asyncio.get_running_loop()
+        try:
+            loop.add_signal_handler(signal.SIGTERM, lambda: loop.create_task(self.drain()))
+        except (NotImplementedError, AttributeError, ValueError):
+            pass  # Windows: GET /drain only
+        if (self.rebalance_load > 0 or self.rebalance_lag_ms > 0) and self.peers:
+            loop.create_task(self.rebalance())
+        if not self.secret:
+            print("Migration: no secret set; /migrate is only accepted from this machine and the --peers")
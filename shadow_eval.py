@@ -0,0 +1,157 @@
+"""
+Shadow evaluation of a candidate model on live traffic
+
+A sampled fraction of the windows the live model transcribes is mirrored to
+a candidate model. The candidate's text never reaches a client. It is only
+compared with the live text, so the switch to a cheaper model can be judged
+on the audio the server actually sees instead of an offline corpus.
+
+Like the cascade (model_cascade.py), shadow jobs come from a small bounded
+queue (idle_queue.py, oldest dropped first) and only start while no live
+decode is in flight.
+Results are served on the WebSocket port:
+
+    GET http://<server>/shadow
+
+    {"model": "moonshine/base", "primary": "base.en", "fraction": 0.1,
+     "windows": 412, "dropped": 3, "stale": 0, "errors": 0,
+     "agreement": 0.71, "wer": 0.084,
+     "latency_ms": {"p50": 61, "p95": 120}, "primary_latency_ms": {"p50": 240, "p95": 410},
+     "rtf": 0.031, "primary_rtf": 0.12}
+
+``agreement`` is the share of windows with identical normalised text.
+``wer`` is the candidate's word error rate against the live model's text,
+not against a human reference.
+"""
+
+import json
+import random
+import re
+import time
+from collections import deque
+from http import HTTPStatus
+
+import numpy as np
+from websockets.datastructures import Headers
+from websockets.http11 import Response
+
+from idle_queue import IdleGatedQueue
+
+SHADOW_PATH = "/shadow"
+DEFAULT_FRACTION = 0.1
+DEFAULT_MAX_PENDING = 4
+DEFAULT_MAX_AGE = 30.0
+LATENCY_SAMPLES = 500  # recent windows kept for the percentiles
+SUMMARY_EVERY = 50     # print a summary after this many windows
+
+
+def normalise(text: str) -> list:
+    """Lower-case words without punctuation."""
+    return re.sub(r"[^\w\s']", " ", text.lower()).split()
+
+
+def word_errors(reference: list, hypothesis: list) -> int:
+    """Word-level edit distance (substitutions + insertions + deletions)."""
+    previous = list(range(len(hypothesis) + 1))
+    for i, ref_word in enumerate(reference, 1):
+        current = [i]
+        for j, hyp_word in enumerate(hypothesis, 1):
+            current.append(min(previous[j] + 1, current[j - 1] + 1,
+                               previous[j - 1] + (ref_word != hyp_word)))
+        previous = current
+    return previous[-1]
+
+
+def percentiles(values) -> dict:
+    if not values:
+        return {"p50": None, "p95": None}
+    return {"p50": round(float(np.percentile(values, 50))), "p95": round(float(np.percentile(values, 95)))}
+
+
+class ShadowEvaluator:
+    """Mirrors sampled live windows to a candidate model and scores it against the live text."""
+
+    def __init__(self, transcribe, model_name: str, primary_name=None,
+                 fraction: float = DEFAULT_FRACTION, max_pending: int = DEFAULT_MAX_PENDING,
+                 max_age: float = DEFAULT_MAX_AGE):
+        # transcribe(audio, language) -> text, a coroutine
+        self.transcribe = transcribe
+        self.model_name = model_name
+        self.primary_name = primary_name  # callable or str
+        self.fraction = fraction
+        self.latency_ms = deque(maxlen=LATENCY_SAMPLES)
+        self.primary_latency_ms = deque(maxlen=LATENCY_SAMPLES)
+        self.stats = {"windows": 0, "dropped": 0, "stale": 0, "errors": 0, "agreed": 0,
+                      "word_errors": 0, "reference_words": 0,
+                      "audio_s": 0.0, "compute_s": 0.0, "primary_compute_s": 0.0}
+        self.queue = IdleGatedQueue(max_pending, max_age, self.stats)
+
+    def offer(self, audio: np.ndarray, text: str, primary_seconds: float, language: str = None):
+        """Called for every live window; mirrors a sampled fraction of them."""
+        if random.random() >= self.fraction:
+            return
+        self.queue.push((audio, text, primary_seconds, language))
+
+    async def run(self):
+        """Worker loop; start once per server with asyncio.create_task."""
+        async for audio, text, primary_seconds, language in self.queue.jobs():
+            started = time.perf_counter()
+            try:
+                candidate = await self.transcribe(audio, language)
+            except Exception as e:
+                self.stats["errors"] += 1
+                print(f"Shadow transcription error: {e}")
+                continue
+            self.record(audio, text, candidate, primary_seconds, time.perf_counter() - started)
+
+    def record(self, audio, primary: str, candidate: str, primary_seconds: float, seconds: float):
+        reference, hypothesis = normalise(primary), normalise(candidate)
+        stats = self.stats
+        stats["windows"] += 1
+        stats["agreed"] += reference == hypothesis
+        stats["word_errors"] += word_errors(reference, hypothesis)
+        stats["reference_words"] += len(reference)
+        stats["audio_s"] += len(audio) / 16000
+        stats["compute_s"] += seconds
+        stats["primary_compute_s"] += primary_seconds
+        self.latency_ms.append(seconds * 1000)
+        self.primary_latency_ms.append(primary_seconds * 1000)
+        if stats["windows"] % SUMMARY_EVERY == 0:
+            summary = self.snapshot()
+            print(f"Shadow {self.model_name}: {summary['windows']} windows, agreement {summary['agreement']}, "
+                  f"WER vs live {summary['wer']}, p50 {summary['latency_ms']['p50']} ms "
+                  f"(live {summary['primary_latency_ms']['p50']} ms)")
+
+    def snapshot(self) -> dict:
+        stats = self.stats
+        windows = stats["windows"]
+        audio_s = stats["audio_s"]
+        primary = self.primary_name() if callable(self.primary_name) else self.primary_name
+        return {
+            "model": self.model_name,
+            "primary": primary,
+            "fraction": self.fraction,
+            "windows": windows,
+            "dropped": stats["dropped"],
+            "stale": stats["stale"],
+            "errors": stats["errors"],
+            "agreement": round(stats["agreed"] / windows, 3) if windows else None,
+            # Empty live windows count every candidate word as an error
+            "wer": round(stats["word_errors"] / max(stats["reference_words"], 1), 3) if windows else None,
+            "latency_ms": percentiles(self.latency_ms),
+            "primary_latency_ms": percentiles(self.primary_latency_ms),
+            "rtf": round(stats["compute_s"] / audio_s, 3) if audio_s else None,
+            "primary_rtf": round(stats["primary_compute_s"] / audio_s, 3) if audio_s else None,
+        }
+
+    def process_request(self, connection, request):
+        """websockets hook: answer GET /shadow with the comparison so far."""
+        if request.path.split("?", 1)[0] != SHADOW_PATH:
+            return None
+        body = json.dumps(self.snapshot()).encode()
+        headers = Headers([
+            ("Content-Type", "application/json"),
+            ("Content-Length", str(len(body))),
+            ("Cache-Control", "no-cache"),
+        ])
+        return Response(HTTPStatus.OK.value, HTTPStatus.OK.phrase, headers, body)
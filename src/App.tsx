@@ -1,24 +1,73 @@
-import { useState, useRef, useCallback, useEffect } from 'react';
+import { memo, useState, useRef, useCallback, useEffect, useMemo } from 'react';
 import SourcePicker from './components/SourcePicker';
 import SettingsPanel from './components/SettingsPanel';
-import { OverlaySettings, CaptureState, ConnectionStatus } from './types';
+import TranscriptSearch from './components/TranscriptSearch';
+import TranscriptView from './components/TranscriptView';
+import { TranscriptBuffer, useFrameState, useTranscriptRows } from './transcriptBuffer';
+import { OverlaySettings, CaptureState, ConnectionStatus, FlowStats, WhisperSegment, EngineStats, CaptureStats } from './types';
 import { translations, Language } from './i18n';
+import { connectLocalEngine, createCaptureWorklet, EngineControl } from './localEngine';
+import { WasmEngine } from './wasmEngine';
+import type { ServerStatus, TranscriptContext, TranscriptHit } from './vite-env';
 
 // Backend types
-type BackendType = 'whisper' | 'moonshine';
+type BackendType = 'whisper' | 'moonshine' | 'local' | 'wasm';
+
+// Audio path to the server; results always come back over the WebSocket
+type TransportType = 'websocket' | 'datagram';
+
+// Default server per backend; more can be added, comma-separated
+const DEFAULT_SERVERS: Record<'whisper' | 'moonshine', string> = {
+  whisper: 'ws://localhost:9090',
+  moonshine: 'ws://localhost:9091',
+};
+
+const emptyFlowStats: FlowStats = {
+  inFlight: 0,
+  serverQueueDepth: 0,
+  serverQueueMs: 0,
+  dropped: 0,
+  bufferedBytes: 0,
+};
+
+// Subscribes to the buffer itself, so new segments re-render only this
+const LiveTranscript = memo(function LiveTranscript({ buffer, placeholder }: { buffer: TranscriptBuffer; placeholder: string }) {
+  const rows = useTranscriptRows(buffer);
+  return (
+    <TranscriptView
+      rows={rows}
+      follow
+      placeholder={<div className="transcript-placeholder">{placeholder}</div>}
+    />
+  );
+});
 
 function App() {
   // State
   const [captureState, setCaptureState] = useState<CaptureState>('idle');
   const [connectionStatus, setConnectionStatus] = useState<ConnectionStatus>('disconnected');
   const [showSourcePicker, setShowSourcePicker] = useState(false);
-  const [transcript, setTranscript] = useState('');
+  // The live transcript lives outside React state; only its view re-renders
+  const [transcriptBuffer] = useState(() => new TranscriptBuffer());
   const [selectedBackend, setSelectedBackend] = useState<BackendType>('whisper');
+  const [transport, setTransport] = useState<TransportType>('websocket');
+  const [publishChannel, setPublishChannel] = useState('');
+  const [viewerUrl, setViewerUrl] = useState<string | null>(null);
+  const [publishRejected, setPublishRejected] = useState(false);
   const [uiLanguage, setUiLanguage] = useState<Language>('en');
   const [transcriptionLanguage, setTranscriptionLanguage] = useState('auto');
   const [selectedModel, setSelectedModel] = useState('base.en');
   const [modelLoading, setModelLoading] = useState(false);
   const [modelLoadProgress, setModelLoadProgress] = useState(0);
+  // Telemetry arrives with every credit and stats message: one update per frame
+  const [flowStats, setFlowStats] = useFrameState<FlowStats>(emptyFlowStats);
+  const [engineStats, setEngineStats] = useFrameState<EngineStats | null>(null);
+  const [captureStats, setCaptureStats] = useFrameState<CaptureStats | null>(null);
+  const [serverLists, setServerLists] = useState(DEFAULT_SERVERS);
+  const [serverStatus, setServerStatus] = useState<ServerStatus[]>([]);
+  const [activeServer, setActiveServer] = useState<string | null>(null);
+  // A search hit and the saved segments around it, shown instead of the live transcript
+  const [historyView, setHistoryView] = useState<{ context: TranscriptContext; doc: number } | null>(null);
   const [overlaySettings, setOverlaySettings] = useState<OverlaySettings>({
     fontSize: 32,
     fontFamily: 'Segoe UI',
@@ -28,18 +77,31 @@ function App() {
     maxLines: 2,
   });
 
-  // Server URLs based on backend
-  const serverUrl = selectedBackend === 'whisper' ? 'ws://localhost:9090' : 'ws://localhost:9091';
+  // Servers for the selected backend; the main process probes them and the
+  // capture pipeline connects to the least-loaded one
+  const serverList = selectedBackend === 'whisper' || selectedBackend === 'moonshine'
+    ? serverLists[selectedBackend]
+    : '';
+  const servers = serverList.split(/[\s,]+/).filter(Boolean);
+  const serverUrl = servers[0] ?? '';
 
   // Translation function
   const t = translations[uiLanguage];
 
   // Refs
-  const wsRef = useRef<WebSocket | null>(null);
   const mediaStreamRef = useRef<MediaStream | null>(null);
   const audioContextRef = useRef<AudioContext | null>(null);
-  const processorRef = useRef<ScriptProcessorNode | null>(null);
-  const isCapturingRef = useRef(false);
+  // Capture pipeline in the hidden capture window: message listener cleanup
+  const captureCleanupRef = useRef<(() => void) | null>(null);
+  const appCaptureCleanupRef = useRef<(() => void) | null>(null);
+  const lastSegmentIdRef = useRef(-1);
+  const activeServerRef = useRef<string | null>(null);
+  // In-app/WASM engine: control channel, capture worklet, exit listener cleanup
+  const localControlRef = useRef<EngineControl | null>(null);
+  // True when the engine sends captions to the overlay itself (in-app engine)
+  const overlayDirectRef = useRef(false);
+  const workletRef = useRef<AudioWorkletNode | null>(null);
+  const localExitCleanupRef = useRef<(() => void) | null>(null);
 
   // Clean up on unmount
   useEffect(() => {
@@ -55,9 +117,18 @@ function App() {
     }
   }, [overlaySettings]);
 
+  // Hand the server list to the main process, which probes it
+  useEffect(() => {
+    window.electronAPI?.configureServers(servers);
+  }, [serverList]);
+
+  useEffect(() => {
+    return window.electronAPI?.onServersStatus(setServerStatus);
+  }, []);
+
   // Reset model when backend changes
   useEffect(() => {
-    if (selectedBackend === 'moonshine') {
+    if (selectedBackend === 'moonshine' || selectedBackend === 'local' || selectedBackend === 'wasm') {
       setSelectedModel('moonshine/base');
     } else {
       setSelectedModel('base.en');
@@ -66,24 +137,335 @@ function App() {
 
   // Handle model change while connected
   useEffect(() => {
-    if (wsRef.current && wsRef.current.readyState === WebSocket.OPEN && connectionStatus === 'connected') {
-      // Send model change request to server
-      const config = {
+    if (connectionStatus !== 'connected') {
+      return;
+    }
+    // Send model change request to server
+    const config = {
+      uid: `user_${Date.now()}`,
+      language: transcriptionLanguage === 'auto' ? null : transcriptionLanguage,
+      task: 'transcribe',
+      model: selectedModel,
+      use_vad: true,
+      partials: true,
+      transport,
+      publish: publishChannel || undefined,
+    };
+    if (captureCleanupRef.current && window.electronAPI) {
+      window.electronAPI.sendCaptureConfig(config);
+    } else if (appCaptureCleanupRef.current && window.electronAPI) {
+      window.electronAPI.sendAppCaptureConfig(config);
+    } else if (localControlRef.current) {
+      localControlRef.current.postMessage(config);
+    }
+  }, [selectedModel, transcriptionLanguage, connectionStatus, transport, publishChannel]);
+
+  // Apply a message from the transcription server, relayed by the capture
+  // window or the Linux capture helper, or from an in-app engine
+  const handleServerMessage = (data: any, onReady: () => void) => {
+    // Handle model loading progress
+    if (data.type === 'model_loading') {
+      setModelLoading(true);
+      setModelLoadProgress(data.progress || 0);
+      return;
+    }
+
+    // Text still being decoded: overlay only, never the transcript
+    if (data.type === 'partial') {
+      if (window.electronAPI && !overlayDirectRef.current) {
+        window.electronAPI.showSubtitle(data.partial);
+      }
+      return;
+    }
+
+    if (data.type === 'model_ready') {
+      setModelLoading(false);
+      setModelLoadProgress(100);
+      return;
+    }
+
+    if (data.type === 'model_error') {
+      setModelLoading(false);
+      console.error('Model failed to load:', data.error);
+      if (localControlRef.current) {
+        // Nothing else can transcribe for the in-app engine
+        setCaptureState('error');
+      }
+      return;
+    }
+
+    // In-app engine telemetry
+    if (data.type === 'engine_stats') {
+      setEngineStats({
+        backend: data.backend,
+        rtf: data.rtf,
+        windowMs: data.window_ms,
+        queueMs: data.queue_ms,
+        droppedMs: data.dropped_ms,
+      });
+      return;
+    }
+
+    // Capture pipeline connected to (or failed over or migrated from) a server
+    if (data.type === 'server') {
+      activeServerRef.current = data.url;
+      setActiveServer(data.url);
+      return;
+    }
+    if (data.type === 'failover') {
+      console.warn('Server connection lost, failing over from', data.from);
+      setConnectionStatus('connecting');
+      return;
+    }
+    if (data.type === 'migrate') {
+      console.info('Session moved to', data.url);
+      setConnectionStatus('connecting');
+      return;
+    }
+    if (data.type === 'resumed' || data.type === 'resume_failed') {
+      return;
+    }
+
+    // Capture window telemetry: frame delivery on its (unthrottled) thread
+    if (data.type === 'capture_stats') {
+      setCaptureStats({
+        jitterMs: data.jitter_ms,
+        maxGapMs: data.max_gap_ms,
+        lateFrames: data.late_frames,
+      });
+      return;
+    }
+
+    // Server is fanning our captions out to read-only viewers
+    if (data.type === 'publishing') {
+      setViewerUrl(`${activeServerRef.current ?? serverUrl}${data.subscribe_path}`);
+      setPublishRejected(false);
+      return;
+    }
+
+    // Someone else is already publishing on that channel
+    if (data.type === 'publish_rejected') {
+      setViewerUrl(null);
+      setPublishRejected(true);
+      return;
+    }
+
+    // Server returned credit for frames it has taken off its queue; the
+    // sender (capture window or Linux helper) adds its own counts
+    if (data.type === 'credit') {
+      setFlowStats({
+        inFlight: data.client_in_flight,
+        serverQueueDepth: data.queue_depth,
+        serverQueueMs: data.queue_ms,
+        dropped: data.client_dropped,
+        bufferedBytes: data.client_buffered ?? 0,
+      });
+      return;
+    }
+
+    if (data.message === 'SERVER_READY' || data.status === 'ready') {
+      console.log('Server is ready, starting audio capture...');
+      setModelLoading(false);
+      onReady();
+    }
+
+    // Cascade server re-decoded a low-confidence segment with a larger model
+    if (data.type === 'segment_revision') {
+      const revisions = new Map<number, WhisperSegment>(
+        data.segments.map((s: WhisperSegment) => [s.id, s])
+      );
+      transcriptBuffer.revise(data.segments);
+      window.electronAPI?.recordTranscript(data.segments);
+
+      // Only touch the overlay if the revised segment is still the one showing
+      const latest = revisions.get(lastSegmentIdRef.current);
+      if (latest && window.electronAPI && !overlayDirectRef.current) {
+        window.electronAPI.showSubtitle(latest.text);
+      }
+      return;
+    }
+
+    // Handle transcription segments
+    if (data.segments && data.segments.length > 0) {
+      const added = data.segments.filter((s: WhisperSegment) => s.text.trim());
+      const text = added.map((s: WhisperSegment) => s.text).join(' ').trim();
+      if (text) {
+        lastSegmentIdRef.current = added[added.length - 1].id;
+        transcriptBuffer.append(added);
+        window.electronAPI?.recordTranscript(added);
+
+        // Send to overlay (the capture window and the in-app engine already
+        // sent it there directly)
+        if (window.electronAPI && !overlayDirectRef.current) {
+          window.electronAPI.showSubtitle(text);
+        }
+      }
+    }
+
+    // Handle individual text updates (no segment id; never revised)
+    if (data.text) {
+      lastSegmentIdRef.current = -1;
+      transcriptBuffer.append([{ id: -1, text: data.text }]);
+      window.electronAPI?.recordTranscript([{ id: -1, text: data.text }]);
+
+      if (window.electronAPI && !overlayDirectRef.current) {
+        window.electronAPI.showSubtitle(data.text);
+      }
+    }
+  };
+
+  // Linux: stream one application's audio through the PipeWire/PulseAudio helper
+  const startAppCapture = async (sinkInput: number) => {
+    const api = window.electronAPI;
+    if (!api) {
+      return;
+    }
+    setFlowStats(emptyFlowStats);
+    const url = (await api.pickServer()) ?? serverUrl;
+    activeServerRef.current = url;
+    setActiveServer(url);
+
+    appCaptureCleanupRef.current?.();
+    appCaptureCleanupRef.current = api.onAppCaptureMessage((line) => {
+      try {
+        const data = JSON.parse(line);
+        if (data.type === 'capture_ended') {
+          appCaptureCleanupRef.current?.();
+          appCaptureCleanupRef.current = null;
+          setConnectionStatus('disconnected');
+          setCaptureState(data.code || data.error ? 'error' : 'idle');
+          return;
+        }
+        handleServerMessage(data, () => {
+          setConnectionStatus('connected');
+          setCaptureState('capturing');
+        });
+      } catch (err) {
+        console.error('Error parsing capture helper message:', err);
+      }
+    });
+
+    api.startAppCapture({
+      sinkInput,
+      serverUrl: url,
+      config: {
         uid: `user_${Date.now()}`,
         language: transcriptionLanguage === 'auto' ? null : transcriptionLanguage,
         task: 'transcribe',
         model: selectedModel,
         use_vad: true,
-      };
-      wsRef.current.send(JSON.stringify(config));
-    }
-  }, [selectedModel, transcriptionLanguage, connectionStatus]);
+        partials: true,
+        publish: publishChannel || undefined,
+      },
+    });
+  };
+
+  // In-app engine: the worklet posts audio straight to the engine process,
+  // which sends captions straight to the overlay
+  const startLocalCapture = async (stream: MediaStream) => {
+    const api = window.electronAPI!;
+    const { audio, control } = await connectLocalEngine(selectedModel);
+    localControlRef.current = control;
+    overlayDirectRef.current = true;
+    control.onmessage = (event) => {
+      handleServerMessage(event.data, () => {
+        setConnectionStatus('connected');
+        setCaptureState('capturing');
+      });
+    };
+
+    localExitCleanupRef.current?.();
+    localExitCleanupRef.current = api.onLocalEngineExit((code) => {
+      console.error('In-app engine exited with code', code);
+      stopCapture();
+      setCaptureState('error');
+    });
+
+    const audioContext = new AudioContext({ sampleRate: 48000 });
+    audioContextRef.current = audioContext;
+    const worklet = await createCaptureWorklet(audioContext, audio);
+    workletRef.current = worklet;
+    audioContext.createMediaStreamSource(stream).connect(worklet);
+    worklet.connect(audioContext.destination);
+  };
+
+  // WASM engine: same worklet, but the engine is a Web Worker in this page
+  const startWasmCapture = async (stream: MediaStream) => {
+    const engine = await WasmEngine.start(selectedModel, (data) => {
+      handleServerMessage(data, () => {
+        setConnectionStatus('connected');
+        setCaptureState('capturing');
+      });
+    });
+    localControlRef.current = engine;
+
+    const audioContext = new AudioContext({ sampleRate: 48000 });
+    audioContextRef.current = audioContext;
+    const worklet = await createCaptureWorklet(audioContext, engine.audio);
+    workletRef.current = worklet;
+    audioContext.createMediaStreamSource(stream).connect(worklet);
+    worklet.connect(audioContext.destination);
+  };
+
+  // Server backends: the hidden capture window captures and streams audio
+  // and updates the overlay; this window only shows what it relays
+  const startHiddenCapture = (sourceId: string) => {
+    const api = window.electronAPI!;
+    overlayDirectRef.current = true;
+    captureCleanupRef.current?.();
+    captureCleanupRef.current = api.onCaptureMessage((data) => {
+      if (data.type === 'capture_ended') {
+        captureCleanupRef.current?.();
+        captureCleanupRef.current = null;
+        overlayDirectRef.current = false;
+        setConnectionStatus('disconnected');
+        setCaptureState(data.error ? 'error' : 'idle');
+        if (data.error) {
+          console.error('Capture ended:', data.error);
+        }
+        return;
+      }
+      handleServerMessage(data, () => {
+        setConnectionStatus('connected');
+        setCaptureState('capturing');
+      });
+    });
+
+    api.startCapture({
+      sourceId,
+      config: {
+        uid: `user_${Date.now()}`,
+        language: transcriptionLanguage === 'auto' ? null : transcriptionLanguage,
+        task: 'transcribe',
+        model: selectedModel,
+        use_vad: true,
+        partials: true,
+        transport,
+        publish: publishChannel || undefined,
+      },
+    });
+  };
 
   // Handle source selection and start capture
   const handleSourceSelected = useCallback(async (sourceId: string, _includeAudio: boolean) => {
     setShowSourcePicker(false);
     setCaptureState('connecting');
     setConnectionStatus('connecting');
+    setFlowStats(emptyFlowStats);
+    setEngineStats(null);
+    setCaptureStats(null);
+    transcriptBuffer.reset();
+    window.electronAPI?.startTranscriptSession({ backend: selectedBackend, model: selectedModel });
+
+    if (sourceId.startsWith('pulse:')) {
+      startAppCapture(Number(sourceId.slice('pulse:'.length)));
+      return;
+    }
+
+    if (selectedBackend !== 'local' && selectedBackend !== 'wasm') {
+      startHiddenCapture(sourceId);
+      return;
+    }
 
     try {
       // Get the media stream with system audio
@@ -115,170 +497,54 @@ function App() {
 
       mediaStreamRef.current = stream;
 
-      // Set up WebSocket connection
-      const ws = new WebSocket(serverUrl);
-      wsRef.current = ws;
-
-      ws.onopen = () => {
-        console.log('WebSocket connected');
-        setConnectionStatus('connected');
-
-        // Send initial configuration to WhisperLive server
-        const config = {
-          uid: `user_${Date.now()}`,
-          language: transcriptionLanguage === 'auto' ? null : transcriptionLanguage,
-          task: 'transcribe',
-          model: selectedModel,
-          use_vad: true,
-        };
-        ws.send(JSON.stringify(config));
-      };
-
-      ws.onmessage = (event) => {
-        try {
-          const data = JSON.parse(event.data);
-          console.log('Server message:', data);
-
-          // Handle model loading progress
-          if (data.type === 'model_loading') {
-            setModelLoading(true);
-            setModelLoadProgress(data.progress || 0);
-            return;
-          }
-
-          if (data.type === 'model_ready') {
-            setModelLoading(false);
-            setModelLoadProgress(100);
-            return;
-          }
-
-          if (data.message === 'SERVER_READY' || data.status === 'ready') {
-            console.log('Server is ready, starting audio capture...');
-            setModelLoading(false);
-            startAudioCapture(stream);
-            setCaptureState('capturing');
-          }
-
-          // Handle transcription segments
-          if (data.segments && data.segments.length > 0) {
-            const text = data.segments.map((s: { text: string }) => s.text).join(' ').trim();
-            if (text) {
-              setTranscript((prev) => {
-                const newTranscript = prev + ' ' + text;
-                // Keep only last 1000 characters for display
-                return newTranscript.slice(-1000);
-              });
-
-              // Send to overlay
-              if (window.electronAPI) {
-                window.electronAPI.showSubtitle(text);
-              }
-            }
-          }
-
-          // Handle individual text updates
-          if (data.text) {
-            setTranscript((prev) => {
-              const newTranscript = prev + ' ' + data.text;
-              return newTranscript.slice(-1000);
-            });
-
-            if (window.electronAPI) {
-              window.electronAPI.showSubtitle(data.text);
-            }
-          }
-        } catch (err) {
-          console.error('Error parsing message:', err);
-        }
-      };
-
-      ws.onerror = (error) => {
-        console.error('WebSocket error:', error);
-        setConnectionStatus('disconnected');
-        setCaptureState('error');
-      };
-
-      ws.onclose = () => {
-        console.log('WebSocket closed');
-        setConnectionStatus('disconnected');
-        if (captureState === 'capturing') {
-          setCaptureState('idle');
-        }
-      };
+      // In-app engines: the capture worklet runs on the audio thread and
+      // posts frames straight to the engine, so this window's scheduling
+      // does not touch the audio path
+      if (selectedBackend === 'local') {
+        await startLocalCapture(stream);
+      } else {
+        await startWasmCapture(stream);
+      }
     } catch (error) {
       console.error('Error starting capture:', error);
       setCaptureState('error');
       setConnectionStatus('disconnected');
       alert(`Failed to start capture: ${error instanceof Error ? error.message : 'Unknown error'}`);
     }
-  }, [serverUrl, transcriptionLanguage, captureState]);
-
-  // Start audio capture and send to WebSocket
-  const startAudioCapture = useCallback((stream: MediaStream) => {
-    try {
-      // Create audio context with 48kHz sample rate (what browsers typically capture at)
-      const audioContext = new AudioContext({ sampleRate: 48000 });
-      audioContextRef.current = audioContext;
-
-      const source = audioContext.createMediaStreamSource(stream);
-
-      // Create script processor for audio processing
-      // Using 4096 buffer size for smooth processing
-      const processor = audioContext.createScriptProcessor(4096, 1, 1);
-      processorRef.current = processor;
-
-      // Target sample rate for Whisper (16kHz)
-      const targetSampleRate = 16000;
-      const resampleRatio = audioContext.sampleRate / targetSampleRate;
-
-      isCapturingRef.current = true;
-
-      processor.onaudioprocess = (event) => {
-        if (!isCapturingRef.current || !wsRef.current || wsRef.current.readyState !== WebSocket.OPEN) {
-          return;
-        }
-
-        const inputData = event.inputBuffer.getChannelData(0);
-
-        // Downsample from 48kHz to 16kHz
-        const outputLength = Math.floor(inputData.length / resampleRatio);
-        const outputData = new Float32Array(outputLength);
-
-        for (let i = 0; i < outputLength; i++) {
-          const srcIndex = Math.floor(i * resampleRatio);
-          outputData[i] = inputData[srcIndex];
-        }
-
-        // Send audio data as binary (Float32Array)
-        wsRef.current.send(outputData.buffer);
-      };
-
-      // Connect audio nodes
-      source.connect(processor);
-      processor.connect(audioContext.destination);
-
-      console.log('Audio capture started with sample rate:', audioContext.sampleRate);
-    } catch (error) {
-      console.error('Error starting audio capture:', error);
-      setCaptureState('error');
-    }
-  }, []);
+  }, [serverUrl, transcriptionLanguage, captureState, transport, publishChannel, selectedBackend, selectedModel, transcriptBuffer]);
 
   // Stop capture and clean up
   const stopCapture = useCallback(() => {
-    isCapturingRef.current = false;
+    // Stop the hidden capture window's pipeline
+    if (captureCleanupRef.current && window.electronAPI) {
+      window.electronAPI.stopCapture();
+      captureCleanupRef.current();
+      captureCleanupRef.current = null;
+    }
 
-    // Close WebSocket
-    if (wsRef.current) {
-      wsRef.current.close();
-      wsRef.current = null;
+    // Stop the Linux capture helper
+    if (appCaptureCleanupRef.current && window.electronAPI) {
+      window.electronAPI.stopAppCapture();
+      appCaptureCleanupRef.current();
+      appCaptureCleanupRef.current = null;
     }
 
-    // Stop audio processing
-    if (processorRef.current) {
-      processorRef.current.disconnect();
-      processorRef.current = null;
+    // Stop the in-app engine session
+    if (workletRef.current) {
+      workletRef.current.port.postMessage({ type: 'stop' });
+      workletRef.current.disconnect();
+      workletRef.current = null;
     }
+    if (localControlRef.current) {
+      localControlRef.current.close();
+      localControlRef.current = null;
+      if (overlayDirectRef.current) {
+        window.electronAPI?.stopLocalEngine();
+      }
+    }
+    overlayDirectRef.current = false;
+    localExitCleanupRef.current?.();
+    localExitCleanupRef.current = null;
 
     // Close audio context
     if (audioContextRef.current) {
@@ -294,6 +560,11 @@ function App() {
 
     setCaptureState('idle');
     setConnectionStatus('disconnected');
+    setViewerUrl(null);
+    setPublishRejected(false);
+    setActiveServer(null);
+    activeServerRef.current = null;
+    window.electronAPI?.endTranscriptSession();
 
     // Clear overlay
     if (window.electronAPI) {
@@ -301,15 +572,35 @@ function App() {
     }
   }, []);
 
+  // Search hit: show the saved segments around it
+  const jumpToSegment = useCallback(async (hit: TranscriptHit) => {
+    const context = await window.electronAPI?.getTranscriptContext({ session: hit.session, doc: hit.doc });
+    if (context) {
+      setHistoryView({ context, doc: hit.doc });
+    }
+  }, []);
+
+  const historyRows = useMemo(() => {
+    if (!historyView) {
+      return [];
+    }
+    return historyView.context.segments.map((s) => ({
+      key: `${s.doc}`,
+      text: s.text,
+      offsetMs: s.offsetMs,
+      highlight: s.doc === historyView.doc,
+    }));
+  }, [historyView]);
+
   // Handle start capture button
   const handleStartCapture = () => {
     setShowSourcePicker(true);
   };
 
   // Handle settings change
-  const handleSettingsChange = (newSettings: Partial<OverlaySettings>) => {
+  const handleSettingsChange = useCallback((newSettings: Partial<OverlaySettings>) => {
     setOverlaySettings((prev) => ({ ...prev, ...newSettings }));
-  };
+  }, []);
 
   // Get status text and color
   const getStatusInfo = () => {
@@ -358,6 +649,52 @@ function App() {
               {connectionStatus === 'connected' ? (uiLanguage === 'en' ? '✅ Connected' : '✅ Verbunden') : (uiLanguage === 'en' ? '❌ Disconnected' : '❌ Getrennt')}
             </span>
           </div>
+          {connectionStatus === 'connected' && (
+            <>
+              <div className="status-row">
+                <span className="status-label">{uiLanguage === 'en' ? 'Frames in flight' : 'Frames unterwegs'}</span>
+                <span className="status-value">
+                  {flowStats.inFlight} ({Math.round(flowStats.bufferedBytes / 1024)} KB)
+                </span>
+              </div>
+              <div className="status-row">
+                <span className="status-label">{uiLanguage === 'en' ? 'Server queue' : 'Server-Warteschlange'}</span>
+                <span className="status-value">
+                  {flowStats.serverQueueDepth} ({flowStats.serverQueueMs} ms)
+                </span>
+              </div>
+              <div className="status-row">
+                <span className="status-label">{uiLanguage === 'en' ? 'Dropped frames' : 'Verworfene Frames'}</span>
+                <span className="status-value" style={{ color: flowStats.dropped > 0 ? 'var(--warning)' : undefined }}>
+                  {flowStats.dropped}
+                </span>
+              </div>
+            </>
+          )}
+          {captureStats && (
+            <div className="status-row">
+              <span className="status-label">{uiLanguage === 'en' ? 'Frame jitter' : 'Frame-Jitter'}</span>
+              <span className="status-value" style={{ color: captureStats.lateFrames > 0 ? 'var(--warning)' : undefined }}>
+                {captureStats.jitterMs} ms (max {captureStats.maxGapMs} ms, {captureStats.lateFrames} {uiLanguage === 'en' ? 'late' : 'verspätet'})
+              </span>
+            </div>
+          )}
+          {engineStats && (
+            <>
+              <div className="status-row">
+                <span className="status-label">{uiLanguage === 'en' ? 'Real-time factor' : 'Echtzeitfaktor'}</span>
+                <span className="status-value" style={{ color: engineStats.rtf > 1 ? 'var(--warning)' : undefined }}>
+                  {engineStats.rtf.toFixed(2)} ({engineStats.windowMs} ms / {uiLanguage === 'en' ? 'window' : 'Fenster'})
+                </span>
+              </div>
+              <div className="status-row">
+                <span className="status-label">{uiLanguage === 'en' ? 'Engine backlog' : 'Engine-Rückstand'}</span>
+                <span className="status-value">
+                  {engineStats.queueMs} ms{engineStats.droppedMs > 0 ? ` (${engineStats.droppedMs} ms ${uiLanguage === 'en' ? 'dropped' : 'verworfen'})` : ''}
+                </span>
+              </div>
+            </>
+          )}
           <div className="status-row">
             <span className="status-label">{t.settings.language}</span>
             <select
@@ -384,6 +721,8 @@ function App() {
             >
               <option value="whisper">🎤 Whisper - {uiLanguage === 'en' ? 'Reliable, many models' : 'Zuverlässig, viele Modelle'}</option>
               <option value="moonshine">🌙 Moonshine - {uiLanguage === 'en' ? '5-15x FASTER!' : '5-15x SCHNELLER!'}</option>
+              <option value="local" disabled={!window.electronAPI}>💻 {uiLanguage === 'en' ? 'In-app engine - no server needed' : 'In-App-Engine - kein Server nötig'}</option>
+              <option value="wasm" disabled={!window.electronAPI}>🧩 {uiLanguage === 'en' ? 'WASM engine - no native addons' : 'WASM-Engine - ohne native Module'}</option>
             </select>
           </div>
           <div style={{ 
@@ -394,7 +733,15 @@ function App() {
             backgroundColor: selectedBackend === 'moonshine' ? 'rgba(74, 222, 128, 0.1)' : 'transparent',
             borderRadius: '4px'
           }}>
-            {selectedBackend === 'moonshine' 
+            {selectedBackend === 'wasm'
+              ? (uiLanguage === 'en'
+                  ? '🧩 Moonshine runs in WebAssembly (SIMD + threads); slower than the in-app engine, but works everywhere'
+                  : '🧩 Moonshine läuft in WebAssembly (SIMD + Threads); langsamer als die In-App-Engine, läuft aber überall')
+              : selectedBackend === 'local'
+              ? (uiLanguage === 'en'
+                  ? '💻 Moonshine runs inside the app; audio never leaves this computer'
+                  : '💻 Moonshine läuft in der App; Audio verlässt diesen Computer nicht')
+              : selectedBackend === 'moonshine' 
               ? (uiLanguage === 'en' 
                   ? '⚡ Moonshine processes audio 5-15x faster than Whisper!' 
                   : '⚡ Moonshine verarbeitet Audio 5-15x schneller als Whisper!')
@@ -402,11 +749,49 @@ function App() {
                   ? 'Whisper offers many model sizes and languages'
                   : 'Whisper bietet viele Modellgrößen und Sprachen')}
           </div>
+          <div className="status-row">
+            <span className="status-label">{uiLanguage === 'en' ? 'Audio transport' : 'Audio-Übertragung'}</span>
+            <select
+              value={transport}
+              onChange={(e) => setTransport(e.target.value as TransportType)}
+              disabled={captureState === 'capturing' || !window.electronAPI || selectedBackend === 'local' || selectedBackend === 'wasm'}
+              style={{ padding: '4px 8px', borderRadius: '4px' }}
+            >
+              <option value="websocket">WebSocket ({uiLanguage === 'en' ? 'default' : 'Standard'})</option>
+              <option value="datagram">UDP + FEC - {uiLanguage === 'en' ? 'for lossy networks' : 'für verlustreiche Netze'}</option>
+            </select>
+          </div>
           <div style={{ marginTop: '8px', fontSize: '11px', color: '#666' }}>
-            {uiLanguage === 'en' 
-              ? `Server: ${serverUrl}` 
-              : `Server: ${serverUrl}`}
+            {selectedBackend === 'local'
+              ? (uiLanguage === 'en' ? 'Server: none (onnxruntime-node in a utility process)' : 'Server: keiner (onnxruntime-node im Utility-Prozess)')
+              : selectedBackend === 'wasm'
+              ? (uiLanguage === 'en' ? 'Server: none (onnxruntime-web in a Web Worker)' : 'Server: keiner (onnxruntime-web im Web Worker)')
+              : `Server: ${activeServer ?? (uiLanguage === 'en' ? 'least loaded of the list below' : 'am wenigsten ausgelastet aus der Liste')}`}
           </div>
+          {(selectedBackend === 'whisper' || selectedBackend === 'moonshine') && (
+            <>
+              <div className="status-row">
+                <span className="status-label">{uiLanguage === 'en' ? 'Servers' : 'Server'}</span>
+                <input
+                  type="text"
+                  value={serverList}
+                  onChange={(e) => setServerLists((prev) => ({ ...prev, [selectedBackend]: e.target.value }))}
+                  disabled={captureState === 'capturing'}
+                  placeholder={DEFAULT_SERVERS[selectedBackend]}
+                  style={{ padding: '4px 8px', borderRadius: '4px', minWidth: '260px' }}
+                />
+              </div>
+              {serverStatus.map((server) => (
+                <div key={server.url} style={{ fontSize: '11px', color: server.status === 'ok' ? '#888' : 'var(--warning)' }}>
+                  {server.url === activeServer ? '● ' : '○ '}
+                  {server.url}: {server.status}
+                  {server.rttMs !== undefined ? `, ${server.rttMs} ms` : ''}
+                  {server.load !== undefined ? `, load ${server.load.toFixed(2)}` : ''}
+                  {server.sessions !== undefined ? `, ${server.sessions} ${uiLanguage === 'en' ? 'sessions' : 'Sitzungen'}` : ''}
+                </div>
+              ))}
+            </>
+          )}
         </div>
 
         {/* Model Selection */}
@@ -432,6 +817,10 @@ function App() {
                 <option value="medium.en">Medium.en (769 MB) - {uiLanguage === 'en' ? 'High quality, English' : 'Hohe Qualität, Englisch'}</option>
                 <option value="medium">Medium (769 MB) - {uiLanguage === 'en' ? 'High quality, multilingual' : 'Hohe Qualität, mehrsprachig'}</option>
                 <option value="large-v3">Large-v3 (1550 MB) - {uiLanguage === 'en' ? 'Best quality' : 'Beste Qualität'}</option>
+                <option value="large-v3-turbo-q5_0">⚡ Large-v3 Turbo Q5_0 (547 MB) - {uiLanguage === 'en' ? 'Near-large quality, fast' : 'Fast Large-Qualität, schnell'}</option>
+                <option value="large-v3-turbo">Large-v3 Turbo (1620 MB) - {uiLanguage === 'en' ? 'Near-large quality, multilingual' : 'Fast Large-Qualität, mehrsprachig'}</option>
+                <option value="distil-large-v3-q5_0">⚡ Distil Large-v3 Q5_0 - {uiLanguage === 'en' ? 'Near-large quality, English, quantize first' : 'Fast Large-Qualität, Englisch, zuerst quantisieren'}</option>
+                <option value="distil-large-v3">Distil Large-v3 (1520 MB) - {uiLanguage === 'en' ? 'Near-large quality, English' : 'Fast Large-Qualität, Englisch'}</option>
               </select>
             ) : (
               <select
@@ -442,6 +831,8 @@ function App() {
               >
                 <option value="moonshine/tiny">🌙 Tiny (27 MB) - {uiLanguage === 'en' ? 'Ultra-fast, English' : 'Ultra-schnell, Englisch'}</option>
                 <option value="moonshine/base">🌙 Base (62 MB) - {uiLanguage === 'en' ? 'Best quality, English' : 'Beste Qualität, Englisch'}</option>
+                <option value="moonshine/tiny-int8">⚡ Tiny INT8 - {uiLanguage === 'en' ? 'Quantized, run quantize_moonshine.py first' : 'Quantisiert, zuerst quantize_moonshine.py ausführen'}</option>
+                <option value="moonshine/base-int8">⚡ Base INT8 - {uiLanguage === 'en' ? 'Quantized, run quantize_moonshine.py first' : 'Quantisiert, zuerst quantize_moonshine.py ausführen'}</option>
                 <option value="moonshine/tiny-ar">🌙 Tiny-AR (27 MB) - {uiLanguage === 'en' ? 'Arabic' : 'Arabisch'}</option>
                 <option value="moonshine/tiny-zh">🌙 Tiny-ZH (27 MB) - {uiLanguage === 'en' ? 'Chinese' : 'Chinesisch'}</option>
                 <option value="moonshine/tiny-ja">🌙 Tiny-JA (27 MB) - {uiLanguage === 'en' ? 'Japanese' : 'Japanisch'}</option>
@@ -522,6 +913,38 @@ function App() {
           </div>
         </div>
 
+        {/* Caption Sharing */}
+        <div className="panel">
+          <h3 className="panel-title">📡 {uiLanguage === 'en' ? 'Share Captions' : 'Untertitel teilen'}</h3>
+          <div className="status-row">
+            <span className="status-label">{uiLanguage === 'en' ? 'Channel name' : 'Kanalname'}</span>
+            <input
+              type="text"
+              value={publishChannel}
+              onChange={(e) => setPublishChannel(e.target.value.replace(/[^A-Za-z0-9_-]/g, '').slice(0, 64))}
+              disabled={captureState === 'capturing'}
+              placeholder={uiLanguage === 'en' ? 'off' : 'aus'}
+              style={{ padding: '4px 8px', borderRadius: '4px' }}
+            />
+          </div>
+          {publishRejected && (
+            <div style={{ marginTop: '8px', fontSize: '11px', color: '#c62828' }}>
+              {uiLanguage === 'en'
+                ? 'This channel already has a publisher; captions are not being shared.'
+                : 'Dieser Kanal hat bereits einen Sender; Untertitel werden nicht geteilt.'}
+            </div>
+          )}
+          {viewerUrl && (
+            <div style={{ marginTop: '8px', fontSize: '11px', color: '#666' }}>
+              <div>{uiLanguage === 'en' ? 'Viewers connect to: ' : 'Zuschauer verbinden sich mit: '}{viewerUrl}</div>
+              <div>
+                {uiLanguage === 'en' ? 'OBS browser source: ' : 'OBS-Browserquelle: '}
+                {viewerUrl.replace(/^ws/, 'http').replace('/subscribe/', '/overlay/')}
+              </div>
+            </div>
+          )}
+        </div>
+
         {/* Capture Controls */}
         <div className="panel">
           <h3 className="panel-title">🎤 {uiLanguage === 'en' ? 'Audio Capture' : 'Audio-Aufnahme'}</h3>
@@ -545,15 +968,20 @@ function App() {
         {/* Transcript Display */}
         <div className="panel transcript-panel">
           <h3 className="panel-title">📝 {t.transcript.title}</h3>
-          <div className="transcript-content">
-            {transcript ? (
-              transcript.trim()
-            ) : (
-              <div className="transcript-placeholder">
-                {t.transcript.empty}
+          <TranscriptSearch onJump={jumpToSegment} uiLanguage={uiLanguage} />
+          {historyView ? (
+            <>
+              <div className="transcript-search-summary">
+                <button className="btn transcript-back" onClick={() => setHistoryView(null)}>
+                  {uiLanguage === 'en' ? '← Back to live' : '← Zurück zu live'}
+                </button>
+                {new Date(historyView.context.session.startedAt).toLocaleString()} · {historyView.context.session.model}
               </div>
-            )}
-          </div>
+              <TranscriptView key="history" rows={historyRows} scrollToKey={`${historyView.doc}`} />
+            </>
+          ) : (
+            <LiveTranscript buffer={transcriptBuffer} placeholder={t.transcript.empty} />
+          )}
         </div>
       </main>
 
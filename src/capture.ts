@@ -0,0 +1,409 @@
+// Capture pipeline for the hidden capture window (electron/main.cjs). It
+// holds getUserMedia, the capture worklet and the server connection in a
+// window that is never shown and has background throttling off, so frame
+// delivery does not depend on whether the settings window is visible.
+//
+// The settings window only sends commands (start/config/stop) and gets back
+// the server's messages plus capture telemetry, relayed by the main process,
+// the same way the Linux capture helper reports. Captions go to the overlay
+// from here.
+//
+// The main process picks the server (electron/server-pool.cjs). If the
+// connection drops, the pipeline asks for another server and carries on:
+// capture keeps running, frames captured in between are held back and sent
+// once the new server is ready, and segment ids are offset so they stay
+// unique across servers.
+//
+// A server that drains or sheds load can also move the session to a peer
+// (session_migration.py): it sends "migrate" with the peer's url and a resume
+// token, and the pipeline reconnects there. The peer continues the segment ids.
+
+import { createCaptureWorklet } from './localEngine';
+import type { CaptureCommand } from './vite-env';
+
+// Drop frames instead of queueing once this much is waiting in the socket
+const MAX_BUFFERED_BYTES = 256 * 1024;
+
+// Worklet frame: 1365 samples at 16 kHz
+const FRAME_MS = (1365 / 16000) * 1000;
+
+// A frame counts as late when it arrives this long after the previous one
+const LATE_FRAME_MS = FRAME_MS * 2;
+
+const STATS_INTERVAL_MS = 1000;
+
+// Frames held while no server is ready (~2 s); older ones are dropped
+const MAX_RESUME_FRAMES = 24;
+
+// With every server tried, wait this long and try them all again
+const FAILOVER_RETRY_MS = 500;
+const MAX_FAILOVER_ROUNDS = 6;
+
+interface Pipeline {
+  stream: MediaStream;
+  config: Record<string, unknown>;
+  ws: WebSocket | null;
+  serverUrl: string | null;
+  ready: boolean;
+  audioContext: AudioContext | null;
+  worklet: AudioWorkletNode | null;
+  frames: MessagePort | null;
+  datagram: boolean;
+  statsTimer: number;
+  // Captured while connecting; sent once the server is ready
+  pending: Float32Array[];
+  // Added to the current server's segment ids
+  idOffset: number;
+  nextId: number;
+  // Servers tried since the last successful connection
+  tried: string[];
+  rounds: number;
+}
+
+const api = window.electronAPI!;
+let pipeline: Pipeline | null = null;
+let lastSegmentId = -1;
+
+// Credit accounting: frame n may be sent only while n <= granted
+const flow = { enabled: false, granted: 0, sent: 0, dropped: 0 };
+
+// Frame arrival on this thread since the last capture_stats message
+const timing = { last: 0, frames: 0, jitter: 0, maxGap: 0, late: 0 };
+
+const report = (message: Record<string, unknown>) => api.sendCaptureMessage(message);
+
+function send(current: Pipeline, frame: Float32Array) {
+  const ws = current.ws!;
+  // Datagram audio is real-time and lossy by design, so it bypasses credits
+  if (current.datagram) {
+    api.sendAudioDatagram(frame);
+    return;
+  }
+  // Out of credit or socket backed up: drop this frame rather than add lag
+  const overCredit = flow.enabled && flow.sent >= flow.granted;
+  if (overCredit || ws.bufferedAmount > MAX_BUFFERED_BYTES) {
+    flow.dropped++;
+    return;
+  }
+  ws.send(frame.buffer);
+  flow.sent++;
+}
+
+function sendFrame(frame: Float32Array) {
+  const now = performance.now();
+  if (timing.last) {
+    const gap = now - timing.last;
+    timing.frames++;
+    timing.jitter += Math.abs(gap - FRAME_MS);
+    timing.maxGap = Math.max(timing.maxGap, gap);
+    if (gap > LATE_FRAME_MS) {
+      timing.late++;
+    }
+  }
+  timing.last = now;
+
+  const current = pipeline;
+  if (!current) {
+    return;
+  }
+  if (!current.ready || !current.ws || current.ws.readyState !== WebSocket.OPEN) {
+    current.pending.push(frame);
+    if (current.pending.length > MAX_RESUME_FRAMES) {
+      current.pending.shift();
+      flow.dropped++;
+    }
+    return;
+  }
+  send(current, frame);
+}
+
+function reportTiming() {
+  report({
+    type: 'capture_stats',
+    frame_ms: Math.round(FRAME_MS),
+    jitter_ms: timing.frames ? Math.round(timing.jitter / timing.frames) : 0,
+    max_gap_ms: Math.round(timing.maxGap),
+    late_frames: timing.late,
+  });
+  timing.frames = 0;
+  timing.jitter = 0;
+  timing.maxGap = 0;
+}
+
+async function startAudio(current: Pipeline) {
+  const audioContext = new AudioContext({ sampleRate: 48000 });
+  current.audioContext = audioContext;
+  const channel = new MessageChannel();
+  channel.port1.onmessage = (event) => sendFrame(event.data);
+  current.frames = channel.port1;
+  const worklet = await createCaptureWorklet(audioContext, channel.port2);
+  current.worklet = worklet;
+  audioContext.createMediaStreamSource(current.stream).connect(worklet);
+  worklet.connect(audioContext.destination);
+  current.statsTimer = window.setInterval(reportTiming, STATS_INTERVAL_MS);
+}
+
+// Keep segment ids unique across servers, which each count from 0
+function renumber(current: Pipeline, segments: { id: number }[]) {
+  return segments.map((segment) => {
+    const id = segment.id + current.idOffset;
+    current.nextId = Math.max(current.nextId, id + 1);
+    return { ...segment, id };
+  });
+}
+
+// Server messages this window acts on; everything is relayed to settings
+function handleServerMessage(current: Pipeline, data: any) {
+  if (data.type === 'migrate') {
+    report(data);
+    migrate(current, data.url, data.resume);
+    return;
+  }
+  // The peer lost the session state: its ids start over
+  if (data.type === 'resume_failed') {
+    current.idOffset = current.nextId;
+  }
+
+  if (data.message === 'SERVER_READY' || data.status === 'ready') {
+    if (data.flow_control) {
+      flow.enabled = true;
+      flow.granted = data.flow_control.credits;
+    }
+    current.ready = true;
+    current.tried = [];
+    current.rounds = 0;
+    report({ type: 'server', url: current.serverUrl });
+    if (!current.audioContext) {
+      startAudio(current).catch((error) => {
+        if (pipeline === current) {
+          console.error('Error starting audio capture:', error);
+          report({ type: 'capture_ended', error: String(error) });
+          stopPipeline();
+        }
+      });
+    }
+    // Audio captured while (re)connecting
+    const pending = current.pending;
+    current.pending = [];
+    pending.forEach((frame) => send(current, frame));
+  }
+
+  // Server accepted datagram audio: hand the UDP side to the main process
+  if (data.type === 'transport' && data.transport === 'datagram') {
+    api.openDatagramTransport({
+      // IPv6 hosts come bracketed ("[::1]"), which dgram cannot resolve
+      host: new URL(current.serverUrl!).hostname.replace(/^\[(.*)\]$/, '$1'),
+      port: data.port,
+      token: data.token,
+      frameSamples: data.frame_samples,
+      fecGroup: data.fec_group,
+    });
+    current.datagram = true;
+  }
+
+  if (data.type === 'credit') {
+    flow.granted = data.granted;
+    data.client_in_flight = flow.sent - data.consumed;
+    data.client_dropped = flow.dropped;
+    data.client_buffered = current.ws!.bufferedAmount;
+  }
+
+  if (data.segments && data.segments.length > 0) {
+    data.segments = renumber(current, data.segments);
+  }
+
+  // Text still being decoded goes to the overlay only, never the transcript
+  if (data.type === 'partial') {
+    lastSegmentId = -1;
+    api.showSubtitle(data.partial);
+    return;
+  }
+
+  // Overlay: latest segments, and revisions of the segment still showing
+  if (data.type === 'segment_revision') {
+    const latest = data.segments.find((s: { id: number }) => s.id === lastSegmentId);
+    if (latest) {
+      api.showSubtitle(latest.text);
+    }
+  } else if (data.segments && data.segments.length > 0) {
+    const added = data.segments.filter((s: { text: string }) => s.text.trim());
+    const text = added.map((s: { text: string }) => s.text).join(' ').trim();
+    if (text) {
+      lastSegmentId = added[added.length - 1].id;
+      api.showSubtitle(text);
+    }
+  }
+  if (data.text) {
+    lastSegmentId = -1;
+    api.showSubtitle(data.text);
+  }
+
+  report(data);
+}
+
+// Connect to the best server not tried yet; failed is the one that just dropped
+async function connect(current: Pipeline, failed: string | null) {
+  const url = await api.pickServer({ exclude: current.tried, failed });
+  if (pipeline !== current) {
+    return;
+  }
+  if (!url) {
+    if (current.rounds++ < MAX_FAILOVER_ROUNDS) {
+      current.tried = [];
+      window.setTimeout(() => connect(current, null), FAILOVER_RETRY_MS);
+    } else {
+      report({ type: 'capture_ended', error: 'No transcription server available' });
+      stopPipeline();
+    }
+    return;
+  }
+
+  current.tried.push(url);
+  openServer(current, url, current.config);
+}
+
+function openServer(current: Pipeline, url: string, config: Record<string, unknown>) {
+  current.serverUrl = url;
+  current.ready = false;
+  flow.enabled = false;
+  flow.granted = 0;
+  flow.sent = 0;
+
+  const ws = new WebSocket(url);
+  current.ws = ws;
+  ws.onopen = () => ws.send(JSON.stringify(config));
+  ws.onmessage = (event) => {
+    if (current.ws !== ws) {
+      return;
+    }
+    try {
+      handleServerMessage(current, JSON.parse(event.data));
+    } catch (err) {
+      console.error('Error parsing message:', err);
+    }
+  };
+  // An error is always followed by close
+  ws.onclose = () => {
+    if (pipeline === current && current.ws === ws) {
+      failover(current);
+    }
+  };
+}
+
+function detach(current: Pipeline) {
+  current.ws = null;
+  current.ready = false;
+  if (current.datagram) {
+    api.closeDatagramTransport();
+    current.datagram = false;
+  }
+}
+
+function failover(current: Pipeline) {
+  const failed = current.serverUrl;
+  detach(current);
+  current.idOffset = current.nextId;
+  report({ type: 'failover', from: failed });
+  connect(current, failed);
+}
+
+// Planned move: the old server closes this socket itself, so its close is not a failure
+function migrate(current: Pipeline, url: string, token: string) {
+  const old = current.ws;
+  detach(current);
+  old?.close();
+  openServer(current, url, { ...current.config, resume: token });
+}
+
+async function startPipeline({ sourceId, config }: CaptureCommand) {
+  stopPipeline();
+  flow.dropped = 0;
+  timing.last = 0;
+  timing.late = 0;
+  lastSegmentId = -1;
+
+  let stream: MediaStream;
+  try {
+    stream = await navigator.mediaDevices.getUserMedia({
+      audio: {
+        // @ts-ignore - Electron's desktopCapturer requires these constraints
+        mandatory: {
+          chromeMediaSource: 'desktop',
+          chromeMediaSourceId: sourceId,
+        },
+      },
+      video: {
+        // @ts-ignore
+        mandatory: {
+          chromeMediaSource: 'desktop',
+          chromeMediaSourceId: sourceId,
+        },
+      },
+    });
+  } catch (error) {
+    report({ type: 'capture_ended', error: String(error) });
+    return;
+  }
+
+  // We only need audio, stop video tracks
+  stream.getVideoTracks().forEach((track) => track.stop());
+  if (stream.getAudioTracks().length === 0) {
+    stream.getTracks().forEach((track) => track.stop());
+    report({ type: 'capture_ended', error: 'No audio track available. Make sure system audio is enabled.' });
+    return;
+  }
+
+  const current: Pipeline = {
+    stream,
+    config: config ?? {},
+    ws: null,
+    serverUrl: null,
+    ready: false,
+    audioContext: null,
+    worklet: null,
+    frames: null,
+    datagram: false,
+    statsTimer: 0,
+    pending: [],
+    idOffset: 0,
+    nextId: 0,
+    tried: [],
+    rounds: 0,
+  };
+  pipeline = current;
+  connect(current, null);
+}
+
+function stopPipeline() {
+  const current = pipeline;
+  if (!current) {
+    return;
+  }
+  pipeline = null;
+  window.clearInterval(current.statsTimer);
+  if (current.worklet) {
+    current.worklet.port.postMessage({ type: 'stop' });
+    current.worklet.disconnect();
+  }
+  current.frames?.close();
+  current.audioContext?.close();
+  if (current.datagram) {
+    api.closeDatagramTransport();
+  }
+  current.ws?.close();
+  current.stream.getTracks().forEach((track) => track.stop());
+}
+
+api.onCaptureCommand((command) => {
+  if (command.type === 'start') {
+    startPipeline(command);
+  } else if (command.type === 'config' && pipeline) {
+    // Kept for reconnects; applied now if a server is connected
+    pipeline.config = command.config ?? pipeline.config;
+    if (pipeline.ws && pipeline.ws.readyState === WebSocket.OPEN) {
+      pipeline.ws.send(JSON.stringify(pipeline.config));
+    }
+  } else if (command.type === 'stop') {
+    stopPipeline();
+  }
+});
@@ -1,3 +1,4 @@
+import { memo } from 'react';
 import { OverlaySettings } from '../types';
 import { translations, Language } from '../i18n';
 
@@ -152,4 +153,4 @@ function SettingsPanel({ settings, onChange, uiLanguage }: SettingsPanelProps) {
   );
 }
 
-export default SettingsPanel;
+export default memo(SettingsPanel);
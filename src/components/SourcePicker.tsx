@@ -1,5 +1,5 @@
 import { useState, useEffect } from 'react';
-import { SourceInfo } from '../types';
+import { SourceInfo, AppStreamInfo } from '../types';
 import { translations, Language } from '../i18n';
 
 interface SourcePickerProps {
@@ -11,6 +11,7 @@ interface SourcePickerProps {
 function SourcePicker({ onSelect, onClose, uiLanguage }: SourcePickerProps) {
   const t = translations[uiLanguage];
   const [sources, setSources] = useState<SourceInfo[]>([]);
+  const [appStreams, setAppStreams] = useState<AppStreamInfo[]>([]);
   const [selectedSource, setSelectedSource] = useState<string | null>(null);
   const [includeAudio, setIncludeAudio] = useState(true);
   const [loading, setLoading] = useState(true);
@@ -32,6 +33,14 @@ function SourcePicker({ onSelect, onClose, uiLanguage }: SourcePickerProps) {
           appIcon: s.appIcon,
         }));
         setSources(mappedSources);
+        // Linux: individual application streams via PipeWire/PulseAudio
+        if (window.electronAPI.platform === 'linux') {
+          const streams = await window.electronAPI.getAppAudioStreams();
+          setAppStreams(streams.map((s) => ({
+            id: `pulse:${s.index}`,
+            name: s.media ? `${s.application} – ${s.media}` : s.application || s.binary,
+          })));
+        }
         // Auto-select first screen source if available
         const screenSource = mappedSources.find((s) => s.id.startsWith('screen:'));
         if (screenSource) {
@@ -98,6 +107,27 @@ function SourcePicker({ onSelect, onClose, uiLanguage }: SourcePickerProps) {
               ))}
             </div>
 
+            {appStreams.length > 0 && (
+              <>
+                <h3 className="panel-title" style={{ marginTop: '16px' }}>
+                  🔊 {uiLanguage === 'en' ? 'Applications (audio only)' : 'Anwendungen (nur Audio)'}
+                </h3>
+                <div className="sources-grid">
+                  {appStreams.map((stream) => (
+                    <div
+                      key={stream.id}
+                      className={`source-item ${selectedSource === stream.id ? 'selected' : ''}`}
+                      onClick={() => setSelectedSource(stream.id)}
+                    >
+                      <div className="source-name" title={stream.name}>
+                        {stream.name}
+                      </div>
+                    </div>
+                  ))}
+                </div>
+              </>
+            )}
+
             <div className="checkbox-group">
               <input
                 type="checkbox"
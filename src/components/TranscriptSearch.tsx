@@ -0,0 +1,76 @@
+import { memo, useState, useEffect } from 'react';
+import { Language } from '../i18n';
+import type { TranscriptHit, TranscriptSearchResult } from '../vite-env';
+
+interface TranscriptSearchProps {
+  onJump: (hit: TranscriptHit) => void;
+  uiLanguage: Language;
+}
+
+// Wait for a pause in typing before searching
+const SEARCH_DELAY_MS = 150;
+
+// Position in the session, e.g. 1:02:09
+export function formatOffset(ms: number): string {
+  const seconds = Math.max(0, Math.floor(ms / 1000));
+  const h = Math.floor(seconds / 3600);
+  const m = String(Math.floor((seconds % 3600) / 60)).padStart(h ? 2 : 1, '0');
+  const s = String(seconds % 60).padStart(2, '0');
+  return h ? `${h}:${m}:${s}` : `${m}:${s}`;
+}
+
+function TranscriptSearch({ onJump, uiLanguage }: TranscriptSearchProps) {
+  const [query, setQuery] = useState('');
+  const [result, setResult] = useState<TranscriptSearchResult | null>(null);
+
+  useEffect(() => {
+    const api = window.electronAPI;
+    if (!api || !query.trim()) {
+      setResult(null);
+      return;
+    }
+    let current = true;
+    const timer = setTimeout(async () => {
+      const found = await api.searchTranscripts({ query });
+      if (current) {
+        setResult(found);
+      }
+    }, SEARCH_DELAY_MS);
+    return () => {
+      current = false;
+      clearTimeout(timer);
+    };
+  }, [query]);
+
+  return (
+    <div className="transcript-search">
+      <input
+        type="search"
+        value={query}
+        onChange={(e) => setQuery(e.target.value)}
+        placeholder={uiLanguage === 'en'
+          ? 'Search all transcripts: words, prefix*, "a phrase"'
+          : 'Alle Transkripte durchsuchen: Wörter, Präfix*, "eine Phrase"'}
+      />
+      {result && (
+        <div className="transcript-search-results">
+          <div className="transcript-search-summary">
+            {uiLanguage === 'en'
+              ? `${result.total} matches (${result.tookMs} ms)`
+              : `${result.total} Treffer (${result.tookMs} ms)`}
+          </div>
+          {result.results.map((hit) => (
+            <button key={hit.doc} className="transcript-search-hit" onClick={() => onJump(hit)}>
+              <span className="transcript-search-time">
+                {new Date(hit.at).toLocaleDateString()} {formatOffset(hit.offsetMs)}
+              </span>
+              {hit.text}
+            </button>
+          ))}
+        </div>
+      )}
+    </div>
+  );
+}
+
+export default memo(TranscriptSearch);
@@ -0,0 +1,123 @@
+import { memo, ReactNode, useLayoutEffect, useMemo, useRef, useState } from 'react';
+import { TranscriptRow } from '../transcriptBuffer';
+import { formatOffset } from './TranscriptSearch';
+
+interface TranscriptViewProps {
+  rows: TranscriptRow[];
+  // Keep the newest row in view while the user is scrolled to the bottom
+  follow?: boolean;
+  // Centre this row once, when it changes
+  scrollToKey?: string | null;
+  placeholder?: ReactNode;
+}
+
+// Rows are measured once rendered; until then they count as this tall
+const ESTIMATED_ROW_HEIGHT = 26;
+// Rows rendered above and below the visible area, so scrolling does not show gaps
+const OVERSCAN_PX = 300;
+
+// First index whose value is > target
+function upperBound(sorted: Float64Array, target: number): number {
+  let lo = 0;
+  let hi = sorted.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (sorted[mid] <= target) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// Virtualized transcript: only the rows in (and near) the viewport are in
+// the DOM, however long the history, positioned from measured row heights
+function TranscriptView({ rows, follow = false, scrollToKey = null, placeholder }: TranscriptViewProps) {
+  const viewportRef = useRef<HTMLDivElement | null>(null);
+  const rowRefs = useRef(new Map<string, HTMLDivElement>());
+  const heights = useRef(new Map<string, number>());
+  const pinnedRef = useRef(true);
+  const scrolledToRef = useRef<string | null>(null);
+  const [scrollTop, setScrollTop] = useState(0);
+  const [viewportHeight, setViewportHeight] = useState(0);
+  const [measured, setMeasured] = useState(0);
+
+  // offsets[i] is the top of row i; offsets[rows.length] the total height
+  const offsets = useMemo(() => {
+    const result = new Float64Array(rows.length + 1);
+    for (let i = 0; i < rows.length; i++) {
+      result[i + 1] = result[i] + (heights.current.get(rows[i].key) ?? ESTIMATED_ROW_HEIGHT);
+    }
+    return result;
+  }, [rows, measured]);
+  const totalHeight = offsets[rows.length];
+
+  const first = Math.max(0, upperBound(offsets, scrollTop - OVERSCAN_PX) - 1);
+  const last = Math.min(rows.length, upperBound(offsets, scrollTop + viewportHeight + OVERSCAN_PX));
+
+  useLayoutEffect(() => {
+    const viewport = viewportRef.current;
+    if (!viewport) return;
+    setViewportHeight(viewport.clientHeight);
+    const observer = new ResizeObserver(() => setViewportHeight(viewport.clientHeight));
+    observer.observe(viewport);
+    return () => observer.disconnect();
+  }, []);
+
+  // Record the real heights of the rows just rendered; re-lay out before paint if any changed
+  useLayoutEffect(() => {
+    let changed = false;
+    rowRefs.current.forEach((element, key) => {
+      const height = element.offsetHeight;
+      if (height && heights.current.get(key) !== height) {
+        heights.current.set(key, height);
+        changed = true;
+      }
+    });
+    if (changed) {
+      setMeasured((n) => n + 1);
+    }
+  });
+
+  useLayoutEffect(() => {
+    const viewport = viewportRef.current;
+    if (!viewport) return;
+    if (scrollToKey && scrollToKey !== scrolledToRef.current) {
+      const index = rows.findIndex((row) => row.key === scrollToKey);
+      if (index >= 0) {
+        scrolledToRef.current = scrollToKey;
+        viewport.scrollTop = Math.max(0, offsets[index] - viewport.clientHeight / 2);
+      }
+    } else if (follow && pinnedRef.current) {
+      viewport.scrollTop = totalHeight;
+    }
+  }, [rows, offsets, scrollToKey, follow, totalHeight]);
+
+  const handleScroll = () => {
+    const viewport = viewportRef.current!;
+    pinnedRef.current = viewport.scrollTop + viewport.clientHeight >= viewport.scrollHeight - 4;
+    setScrollTop(viewport.scrollTop);
+  };
+
+  return (
+    <div className="transcript-content transcript-viewport" ref={viewportRef} onScroll={handleScroll}>
+      {rows.length === 0 && placeholder}
+      <div style={{ height: totalHeight, position: 'relative' }}>
+        {rows.slice(first, last).map((row, i) => (
+          <div
+            key={row.key}
+            ref={(element) => {
+              if (element) rowRefs.current.set(row.key, element);
+              else rowRefs.current.delete(row.key);
+            }}
+            className={row.highlight ? 'transcript-segment transcript-segment-target' : 'transcript-segment'}
+            style={{ position: 'absolute', top: offsets[first + i], left: 0, right: 0 }}
+          >
+            {row.offsetMs !== undefined && <span className="transcript-search-time">{formatOffset(row.offsetMs)}</span>}
+            {row.text}
+          </div>
+        ))}
+      </div>
+    </div>
+  );
+}
+
+export default memo(TranscriptView);
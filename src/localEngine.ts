@@ -0,0 +1,50 @@
+// Connection to the in-app engine (electron/local-engine.mjs). The main
+// process creates the MessagePorts; the preload forwards them to the page as
+// a 'local-engine-ports' window message.
+
+// What the settings UI needs from an in-app engine's control channel: the
+// servers' config messages in, and a way to end the session
+export interface EngineControl {
+  postMessage(message: unknown): void;
+  close(): void;
+}
+
+export interface LocalEnginePorts {
+  // Handed to the capture worklet, which posts 16 kHz frames on it
+  audio: MessagePort;
+  // Config in; server-style status and results out
+  control: MessagePort;
+}
+
+export function connectLocalEngine(model: string): Promise<LocalEnginePorts> {
+  return new Promise((resolve, reject) => {
+    const api = window.electronAPI;
+    if (!api) {
+      reject(new Error('The in-app engine needs the desktop app'));
+      return;
+    }
+    const onMessage = (event: MessageEvent) => {
+      if (event.source !== window || event.data !== 'local-engine-ports') {
+        return;
+      }
+      window.removeEventListener('message', onMessage);
+      const [audio, control] = event.ports;
+      resolve({ audio, control });
+    };
+    window.addEventListener('message', onMessage);
+    api.startLocalEngine({ model });
+  });
+}
+
+// AudioWorklet that downsamples to 16 kHz and posts frames straight to the engine
+export async function createCaptureWorklet(
+  audioContext: AudioContext,
+  sink: MessagePort,
+): Promise<AudioWorkletNode> {
+  await audioContext.audioWorklet.addModule('capture-worklet.js');
+  const node = new AudioWorkletNode(audioContext, 'capture-processor', {
+    processorOptions: { targetRate: 16000, frameSamples: 1365 },
+  });
+  node.port.postMessage({ type: 'sink', port: sink }, [sink]);
+  return node;
+}
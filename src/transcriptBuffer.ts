@@ -0,0 +1,113 @@
+import { useEffect, useRef, useState, useSyncExternalStore } from 'react';
+import { WhisperSegment } from './types';
+
+// One line of the transcript view
+export interface TranscriptRow {
+  key: string;
+  text: string;
+  // Position in the session, in ms, when the server sent one
+  offsetMs?: number;
+  rev?: number;
+  highlight?: boolean;
+}
+
+// Every segment of the live transcript, outside React state: appending one
+// does not re-render the settings window, only the transcript view, and that
+// at most once per animation frame however many messages arrive in it
+export class TranscriptBuffer {
+  private rows: TranscriptRow[] = [];
+  private snapshot: TranscriptRow[] = [];
+  // Server segment id -> row, so revisions replace the row in place
+  private byId = new Map<number, number>();
+  private nextKey = 0;
+  private listeners = new Set<() => void>();
+  private frame = 0;
+
+  append(segments: WhisperSegment[]) {
+    for (const segment of segments) {
+      if (segment.id !== -1) {
+        this.byId.set(segment.id, this.rows.length);
+      }
+      this.rows.push(this.row(`${this.nextKey++}`, segment));
+    }
+    this.changed();
+  }
+
+  // A new capture session starts an empty transcript. Server segment ids
+  // restart with it, so revisions must not reach the old session's rows;
+  // row keys keep counting so React does not reuse the old rows
+  reset() {
+    this.rows = [];
+    this.byId.clear();
+    this.changed();
+  }
+
+  // Cascade revisions: newer revs replace the segment they revise
+  revise(segments: WhisperSegment[]) {
+    for (const segment of segments) {
+      const index = this.byId.get(segment.id);
+      if (index === undefined) continue;
+      const row = this.rows[index];
+      if ((segment.rev ?? 0) > (row.rev ?? 0)) {
+        const revised = this.row(row.key, segment);
+        this.rows[index] = { ...revised, offsetMs: revised.offsetMs ?? row.offsetMs };
+      }
+    }
+    this.changed();
+  }
+
+  private row(key: string, segment: WhisperSegment): TranscriptRow {
+    return {
+      key,
+      text: segment.text.trim(),
+      rev: segment.rev,
+      offsetMs: segment.start !== undefined ? segment.start * 1000 : undefined,
+    };
+  }
+
+  private changed() {
+    if (!this.frame) {
+      this.frame = requestAnimationFrame(() => {
+        this.frame = 0;
+        this.snapshot = this.rows.slice();
+        this.listeners.forEach((listener) => listener());
+      });
+    }
+  }
+
+  subscribe = (listener: () => void) => {
+    this.listeners.add(listener);
+    return () => {
+      this.listeners.delete(listener);
+    };
+  };
+
+  getSnapshot = () => this.snapshot;
+}
+
+export function useTranscriptRows(buffer: TranscriptBuffer): TranscriptRow[] {
+  return useSyncExternalStore(buffer.subscribe, buffer.getSnapshot);
+}
+
+// useState whose setter applies the latest value at the next animation
+// frame, for telemetry that arrives many times a frame
+export function useFrameState<T>(initial: T): [T, (value: T) => void] {
+  const [value, setValue] = useState(initial);
+  const pending = useRef<{ value: T } | null>(null);
+  const frame = useRef(0);
+  const setLater = useRef((next: T) => {
+    pending.current = { value: next };
+    if (!frame.current) {
+      frame.current = requestAnimationFrame(() => {
+        frame.current = 0;
+        if (pending.current) {
+          setValue(pending.current.value);
+          pending.current = null;
+        }
+      });
+    }
+  }).current;
+
+  useEffect(() => () => cancelAnimationFrame(frame.current), []);
+  return [value, setLater];
+}
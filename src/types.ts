@@ -14,12 +14,44 @@ export interface SourceInfo {
   appIcon: string | null;
 }
 
+// Playback stream of a single application (Linux, PipeWire/PulseAudio)
+export interface AppStreamInfo {
+  id: string;
+  name: string;
+}
+
 export type CaptureState = 'idle' | 'connecting' | 'capturing' | 'error';
 
 export type ConnectionStatus = 'disconnected' | 'connecting' | 'connected';
 
+// Client view of the server's credit-based flow control
+export interface FlowStats {
+  inFlight: number;
+  serverQueueDepth: number;
+  serverQueueMs: number;
+  dropped: number;
+  bufferedBytes: number;
+}
+
+// Telemetry from an in-app engine (see electron/stream-session.mjs)
+export interface EngineStats {
+  backend: string;
+  rtf: number;
+  windowMs: number;
+  queueMs: number;
+  droppedMs: number;
+}
+
+// Frame delivery in the hidden capture window (see src/capture.ts)
+export interface CaptureStats {
+  jitterMs: number;
+  maxGapMs: number;
+  lateFrames: number;
+}
+
 export interface WhisperSegment {
   id: number;
+  rev?: number;
   text: string;
   start?: number;
   end?: number;
@@ -30,4 +62,13 @@ export interface WhisperMessage {
   status?: string;
   segments?: WhisperSegment[];
   text?: string;
+  flow_control?: { credits: number; unit: 'frames' };
+}
+
+export interface CreditMessage {
+  type: 'credit';
+  granted: number;
+  consumed: number;
+  queue_depth: number;
+  queue_ms: number;
 }
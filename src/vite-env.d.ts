@@ -1,5 +1,7 @@
 /// <reference types="vite/client" />
 
+import type { WhisperSegment } from './types';
+
 export interface ElectronSourceInfo {
   id: string;
   name: string;
@@ -16,12 +18,135 @@ export interface ElectronOverlaySettings {
   maxLines?: number;
 }
 
+export interface DatagramTransportOptions {
+  host: string;
+  port: number;
+  token: string;
+  frameSamples: number;
+  fecGroup: number;
+}
+
+export interface AppAudioStream {
+  index: number;
+  application: string;
+  media: string;
+  binary: string;
+  pid: string | null;
+}
+
+export interface AppCaptureOptions {
+  sinkInput: number;
+  serverUrl: string;
+  config: Record<string, unknown>;
+}
+
+export interface CaptureOptions {
+  sourceId: string;
+  config: Record<string, unknown>;
+}
+
+// Last probe of one configured server (electron/server-pool.cjs)
+export interface ServerStatus {
+  url: string;
+  status: 'pending' | 'ok' | 'full' | 'draining' | 'unknown' | 'down';
+  rttMs?: number;
+  load?: number;
+  sessions?: number;
+  maxSessions?: number;
+  rtf?: number;
+  maxLagMs?: number;
+  model?: string;
+}
+
+export interface PickServerOptions {
+  exclude?: string[];
+  // The server whose connection just failed
+  failed?: string | null;
+}
+
+// Sent to the hidden capture window by the main process
+export interface CaptureCommand extends Partial<CaptureOptions> {
+  type: 'start' | 'config' | 'stop';
+}
+
+export interface LocalEngineOptions {
+  model: string;
+}
+
+export interface ModelFiles {
+  encoder: Uint8Array;
+  decoder: Uint8Array;
+  tokenizer: string;
+}
+
+// Transcript history (electron/transcript-store.cjs)
+export interface TranscriptSessionInfo {
+  backend: string;
+  model: string;
+}
+
+export interface TranscriptSearchOptions {
+  // Words, prefix* and "quoted phrases", all of which must match
+  query: string;
+  session?: string | null;
+  limit?: number;
+}
+
+export interface TranscriptHit {
+  session: string;
+  id: number;
+  doc: number;
+  text: string;
+  // When it was received (epoch ms) and where it falls in its session
+  at: number;
+  offsetMs: number;
+  endMs: number | null;
+}
+
+export interface TranscriptSearchResult {
+  results: TranscriptHit[];
+  total: number;
+  tookMs: number;
+}
+
+export interface TranscriptContext {
+  session: TranscriptSessionInfo & { id: string; startedAt: number };
+  segments: TranscriptHit[];
+}
+
 export interface ElectronAPI {
+  platform: string;
   getSources: () => Promise<ElectronSourceInfo[]>;
   showSubtitle: (text: string) => void;
   clearSubtitle: () => void;
   updateOverlaySettings: (settings: ElectronOverlaySettings) => void;
   toggleOverlay: (visible: boolean) => void;
+  openDatagramTransport: (options: DatagramTransportOptions) => void;
+  sendAudioDatagram: (samples: Float32Array) => void;
+  closeDatagramTransport: () => void;
+  startCapture: (options: CaptureOptions) => void;
+  sendCaptureConfig: (config: Record<string, unknown>) => void;
+  stopCapture: () => void;
+  onCaptureMessage: (callback: (message: any) => void) => () => void;
+  configureServers: (urls: string[]) => void;
+  pickServer: (options?: PickServerOptions) => Promise<string | null>;
+  onServersStatus: (callback: (status: ServerStatus[]) => void) => () => void;
+  onCaptureCommand: (callback: (command: CaptureCommand) => void) => void;
+  sendCaptureMessage: (message: Record<string, unknown>) => void;
+  getAppAudioStreams: () => Promise<AppAudioStream[]>;
+  startAppCapture: (options: AppCaptureOptions) => void;
+  sendAppCaptureConfig: (config: Record<string, unknown>) => void;
+  stopAppCapture: () => void;
+  onAppCaptureMessage: (callback: (line: string) => void) => () => void;
+  startLocalEngine: (options: LocalEngineOptions) => void;
+  stopLocalEngine: () => void;
+  onLocalEngineExit: (callback: (code: number) => void) => () => void;
+  readModelFiles: (model: string) => Promise<ModelFiles>;
+  startTranscriptSession: (info: TranscriptSessionInfo) => Promise<string>;
+  recordTranscript: (segments: WhisperSegment[]) => void;
+  endTranscriptSession: () => void;
+  searchTranscripts: (options: TranscriptSearchOptions) => Promise<TranscriptSearchResult>;
+  getTranscriptContext: (options: { session: string; doc: number; radius?: number }) => Promise<TranscriptContext | null>;
   onSubtitleUpdate: (callback: (text: string) => void) => void;
   onSettingsUpdate: (callback: (settings: ElectronOverlaySettings) => void) => void;
 }
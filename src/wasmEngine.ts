@@ -0,0 +1,77 @@
+// Page-side handle for the WASM engine worker (wasmEngine.worker.ts). One
+// worker lives for the whole app, so a loaded model survives stop/start.
+
+import type { WasmModelFiles } from './wasmEngine.worker';
+import type { EngineControl } from './localEngine';
+
+let worker: Worker | null = null;
+const modelCache = new Map<string, WasmModelFiles>();
+
+function toShared(bytes: Uint8Array): SharedArrayBuffer {
+  const shared = new SharedArrayBuffer(bytes.byteLength);
+  new Uint8Array(shared).set(bytes);
+  return shared;
+}
+
+async function loadModelFiles(model: string): Promise<WasmModelFiles> {
+  let files = modelCache.get(model);
+  if (!files) {
+    const read = await window.electronAPI!.readModelFiles(model);
+    files = {
+      encoder: toShared(read.encoder),
+      decoder: toShared(read.decoder),
+      tokenizer: read.tokenizer,
+    };
+    modelCache.set(model, files);
+  }
+  return files;
+}
+
+export class WasmEngine implements EngineControl {
+  // Handed to the capture worklet, which posts 16 kHz frames on it
+  readonly audio: MessagePort;
+  private readonly worker: Worker;
+  private readonly threads: number;
+
+  private constructor(audio: MessagePort, threads: number) {
+    if (!worker) {
+      worker = new Worker(new URL('./wasmEngine.worker.ts', import.meta.url), { type: 'module' });
+    }
+    this.worker = worker;
+    this.audio = audio;
+    this.threads = threads;
+  }
+
+  // threads = 0 keeps onnxruntime-web's default (half the cores, up to 4)
+  static async start(
+    model: string,
+    onMessage: (data: any) => void,
+    threads = 0,
+  ): Promise<WasmEngine> {
+    if (typeof SharedArrayBuffer === 'undefined') {
+      throw new Error('The WASM engine needs SharedArrayBuffer (cross-origin isolation)');
+    }
+    const files = await loadModelFiles(model);
+    const channel = new MessageChannel();
+    const engine = new WasmEngine(channel.port1, threads);
+    engine.worker.onmessage = (event) => onMessage(event.data);
+    engine.worker.postMessage({ type: 'start', model, files, threads }, [channel.port2]);
+    return engine;
+  }
+
+  // Same config messages the servers take; only a model change matters here
+  postMessage(message: any) {
+    if (message.type === 'stop') {
+      this.worker.postMessage(message);
+    } else if (message.model) {
+      loadModelFiles(message.model).then((files) => {
+        this.worker.postMessage({ type: 'load', model: message.model, files, threads: this.threads });
+      });
+    }
+  }
+
+  // The worker closes its end of the audio port and keeps the model loaded
+  close() {
+    this.worker.postMessage({ type: 'stop' });
+  }
+}
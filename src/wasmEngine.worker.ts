@@ -0,0 +1,96 @@
+// WASM engine worker: Moonshine on onnxruntime-web (WebAssembly SIMD128 with
+// threads), for seats that cannot run a server or load native addons. It
+// reuses the in-app engine's decode loop, detokenizer and windowing
+// (electron/*.mjs), so it speaks the same messages as the servers.
+//
+// Model bytes arrive as SharedArrayBuffers, so the page keeps one copy across
+// capture sessions instead of cloning it into every worker message.
+
+import * as ort from 'onnxruntime-web';
+import { MoonshineModel } from '../electron/moonshine-model.mjs';
+import { Detokenizer } from '../electron/detokenizer.mjs';
+import { StreamSession } from '../electron/stream-session.mjs';
+
+export interface WasmModelFiles {
+  encoder: SharedArrayBuffer;
+  decoder: SharedArrayBuffer;
+  tokenizer: string;
+}
+
+// The runtime's .wasm/.mjs files: served from node_modules in development,
+// copied to dist/ort/ by the build
+ort.env.wasm.wasmPaths = import.meta.env.DEV
+  ? '/node_modules/onnxruntime-web/dist/'
+  : new URL('../ort/', import.meta.url).href;
+
+let loaded: { name: string; model: MoonshineModel; detokenizer: Detokenizer } | null = null;
+let session: StreamSession | null = null;
+let audioPort: MessagePort | null = null;
+
+const emit = (message: Record<string, unknown>) => self.postMessage(message);
+
+async function loadModel(name: string, files: WasmModelFiles, threads: number) {
+  if (loaded && loaded.name === name) {
+    return true;
+  }
+  emit({ type: 'model_loading', model: name, progress: 0 });
+  try {
+    if (threads > 0) {
+      ort.env.wasm.numThreads = threads;
+    }
+    const model = await MoonshineModel.create(ort, {
+      encoder: new Uint8Array(files.encoder),
+      decoder: new Uint8Array(files.decoder),
+      sessionOptions: { executionProviders: ['wasm'], graphOptimizationLevel: 'all' },
+    });
+    await loaded?.model.release();
+    loaded = { name, model, detokenizer: new Detokenizer(files.tokenizer) };
+    emit({ type: 'model_ready', model: name, progress: 100, threads: ort.env.wasm.numThreads });
+    return true;
+  } catch (error) {
+    emit({ type: 'model_error', model: name, error: String(error) });
+    return false;
+  }
+}
+
+function stopSession() {
+  session?.close();
+  session = null;
+  audioPort?.close();
+  audioPort = null;
+}
+
+self.onmessage = async (event: MessageEvent) => {
+  const data = event.data;
+  if (data.type === 'start') {
+    stopSession();
+    const current = new StreamSession({
+      transcribe: async (samples, onPartial) => {
+        const stream = loaded!.detokenizer.stream();
+        await loaded!.model.generate(samples, (id) => {
+          if (stream.push(id)) {
+            onPartial(stream.text);
+          }
+        });
+        return stream.finish();
+      },
+      emit,
+      overlay: () => {},
+      backend: 'wasm',
+    });
+    session = current;
+    audioPort = event.ports[0];
+    audioPort.onmessage = (message) => {
+      if (loaded) {
+        current.push(message.data);
+      }
+    };
+    if (await loadModel(data.model, data.files, data.threads) && session === current) {
+      emit({ message: 'SERVER_READY', status: 'ready', backend: 'wasm', model: data.model });
+    }
+  } else if (data.type === 'load') {
+    await loadModel(data.model, data.files, data.threads);
+  } else if (data.type === 'stop') {
+    stopSession();
+  }
+};
@@ -0,0 +1,231 @@
+"""
+Autoscaling supervisor for Moonshine server workers
+
+Runs between --min-workers and --max-workers moonshine_server.py processes on
+consecutive ports, starting at --base-port. It polls every worker's /health
+endpoint (server_health.py) and:
+
+    * spawns a worker when any worker's load stays above --scale-up-load or
+      its worst session lags more than --max-lag-ms, unless a worker is
+      still idle (sessions are on their way to it);
+    * retires a worker when the remaining workers could carry the total load
+      below --scale-down-load. The least busy worker is drained first: its
+      sessions move to the others (session_migration.py), then it exits.
+
+Each worker gets every other port as its migration peers. Workers move
+sessions to an idle peer above --rebalance-load, which defaults to (and may
+not exceed) --scale-up-load: a worker overloaded enough to trigger a spawn
+is also overloaded enough to hand sessions to the new one. With a higher
+rebalance threshold the new worker would sit idle while the load stayed put,
+and the pool would keep growing, then shrinking again. For the same reason
+workers also move sessions while one lags by more than --max-lag-ms, so
+lag alone brings an idle worker into use. Ports with no worker behind them
+are skipped, so clients can list the whole range under "Servers" and the
+app picks whichever workers are up (electron/server-pool.cjs).
+
+Usage:
+    python supervisor.py --min-workers 1 --max-workers 4
+    python supervisor.py --base-port 9091 --max-workers 6 -- --model moonshine/tiny
+
+Arguments after "--" are passed to every worker. Unless given there,
+--threads splits the CPU cores between the maximum number of workers so a
+full pool does not oversubscribe them.
+"""
+
+import argparse
+import json
+import os
+import secrets
+import signal
+import subprocess
+import sys
+import time
+import urllib.request
+from pathlib import Path
+
+WORKER_SCRIPT = Path(__file__).parent / "moonshine_server.py"
+PROBE_TIMEOUT = 1.0
+
+
+class Worker:
+    """One moonshine_server.py process on a fixed port."""
+
+    def __init__(self, port: int, process: subprocess.Popen, secret: str):
+        self.port = port
+        self.secret = secret  # the workers' SFA_MIGRATE_SECRET, which /drain requires
+        self.process = process
+        self.health = None      # last /health reply, None until the first answer
+        self.draining_since = None
+        self.started = time.monotonic()
+
+    @property
+    def url(self) -> str:
+        return f"http://127.0.0.1:{self.port}"
+
+    def probe(self):
+        try:
+            with urllib.request.urlopen(f"{self.url}/health", timeout=PROBE_TIMEOUT) as response:
+                self.health = json.loads(response.read())
+        except Exception:
+            self.health = None
+
+    def drain(self):
+        """Ask the worker to hand its sessions to peers and exit (GET /drain)."""
+        self.draining_since = time.monotonic()
+        try:
+            request = urllib.request.Request(f"{self.url}/drain", headers={"X-Migrate-Secret": self.secret})
+            urllib.request.urlopen(request, timeout=PROBE_TIMEOUT).read()
+        except Exception as e:
+            print(f"[supervisor] /drain on port {self.port} failed ({e}); terminating")
+            self.process.terminate()
+
+
+class Supervisor:
+    def __init__(self, args, worker_args: list):
+        self.args = args
+        self.worker_args = worker_args
+        self.ports = list(range(args.base_port, args.base_port + args.max_workers))
+        self.workers = {}  # port -> Worker
+        self.up_ticks = 0
+        self.down_ticks = 0
+        self.last_action = 0.0
+        # Workers only take migrated sessions from each other
+        self.env = dict(os.environ)
+        self.env.setdefault("SFA_MIGRATE_SECRET", secrets.token_urlsafe(16))
+        self.secret = self.env["SFA_MIGRATE_SECRET"]
+        if "--migrate-secret" in worker_args[:-1]:
+            self.secret = worker_args[worker_args.index("--migrate-secret") + 1]
+
+    def spawn(self):
+        port = next(p for p in self.ports if p not in self.workers)
+        peers = ",".join(f"ws://127.0.0.1:{p}" for p in self.ports if p != port)
+        cmd = [sys.executable, str(WORKER_SCRIPT), "--port", str(port), "--peers", peers,
+               "--rebalance-load", str(self.args.rebalance_load),
+               "--rebalance-lag-ms", str(self.args.max_lag_ms), *self.worker_args]
+        if "--threads" not in self.worker_args:
+            cmd += ["--threads", str(max(1, (os.cpu_count() or 1) // self.args.max_workers))]
+        self.workers[port] = Worker(port, subprocess.Popen(cmd, env=self.env), self.secret)
+        print(f"[supervisor] Started worker on port {port} ({len(self.workers)} running)")
+
+    def reap(self):
+        """Forget workers that exited; finish off drains that take too long."""
+        for port, worker in list(self.workers.items()):
+            if worker.process.poll() is not None:
+                if worker.draining_since is None:
+                    print(f"[supervisor] Worker on port {port} exited unexpectedly "
+                          f"(code {worker.process.returncode})")
+                else:
+                    print(f"[supervisor] Worker on port {port} retired")
+                del self.workers[port]
+            elif (worker.draining_since is not None
+                  and time.monotonic() - worker.draining_since > self.args.drain_timeout):
+                print(f"[supervisor] Worker on port {port} still draining after "
+                      f"{self.args.drain_timeout:.0f} s; terminating")
+                worker.process.terminate()
+
+    def tick(self):
+        self.reap()
+        while len(self.workers) < self.args.min_workers:
+            self.spawn()
+
+        for worker in self.workers.values():
+            worker.probe()
+        serving = [w for w in self.workers.values() if w.draining_since is None]
+        healthy = [w for w in serving if w.health]
+        # A worker still loading its model is capacity on the way: wait for it
+        if len(healthy) < len(serving):
+            self.up_ticks = self.down_ticks = 0
+            return
+
+        loads = [w.health["load"] for w in healthy]
+        lag = max((w.health["max_lag_ms"] for w in healthy), default=0)
+        sessions = sum(w.health["sessions"] for w in healthy)
+        overloaded = max(loads, default=0) > self.args.scale_up_load or lag > self.args.max_lag_ms
+        # An idle worker is capacity that sessions have yet to move to
+        if any(w.health["sessions"] == 0 for w in healthy):
+            overloaded = False
+        spare = (len(healthy) > self.args.min_workers
+                 and sum(loads) / (len(healthy) - 1) < self.args.scale_down_load
+                 and lag <= self.args.max_lag_ms / 2)
+        self.up_ticks = self.up_ticks + 1 if overloaded else 0
+        self.down_ticks = self.down_ticks + 1 if spare else 0
+
+        if time.monotonic() - self.last_action < self.args.cooldown:
+            return
+        if self.up_ticks >= self.args.up_ticks and len(self.workers) < self.args.max_workers:
+            print(f"[supervisor] Scaling up: load {max(loads):.2f}, lag {lag} ms, {sessions} sessions")
+            self.spawn()
+            self.acted()
+        elif self.down_ticks >= self.args.down_ticks:
+            victim = min(healthy, key=lambda w: (w.health["sessions"], w.health["load"]))
+            print(f"[supervisor] Scaling down: total load {sum(loads):.2f} over {len(healthy)} workers; "
+                  f"draining port {victim.port} ({victim.health['sessions']} sessions)")
+            victim.drain()
+            self.acted()
+
+    def acted(self):
+        self.last_action = time.monotonic()
+        self.up_ticks = self.down_ticks = 0
+
+    def run(self):
+        print(f"[supervisor] {self.args.min_workers}-{self.args.max_workers} workers on ports "
+              f"{self.ports[0]}-{self.ports[-1]}")
+        # Stop the workers too when the supervisor itself is stopped
+        signal.signal(signal.SIGTERM, lambda *_: sys.exit(0))
+        try:
+            while True:
+                self.tick()
+                time.sleep(self.args.interval)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            for worker in self.workers.values():
+                worker.process.terminate()
+            for worker in self.workers.values():
+                try:
+                    worker.process.wait(timeout=self.args.drain_timeout)
+                except subprocess.TimeoutExpired:
+                    worker.process.kill()
+            print("[supervisor] Stopped.")
+
+
+def main():
+    argv = sys.argv[1:]
+    worker_args = []
+    if "--" in argv:
+        worker_args = argv[argv.index("--") + 1:]
+        argv = argv[:argv.index("--")]
+
+    parser = argparse.ArgumentParser(description="Autoscaling supervisor for Moonshine server workers",
+                                     epilog="Arguments after -- are passed to every worker.")
+    parser.add_argument("--base-port", type=int, default=9091, help="Port of the first worker")
+    parser.add_argument("--min-workers", type=int, default=1)
+    parser.add_argument("--max-workers", type=int, default=4)
+    parser.add_argument("--scale-up-load", type=float, default=0.8,
+                        help="Spawn a worker while any worker's load is above this")
+    parser.add_argument("--scale-down-load", type=float, default=0.4,
+                        help="Retire a worker when the others would stay below this load")
+    parser.add_argument("--max-lag-ms", type=int, default=1000,
+                        help="Spawn a worker while any session lags more than this")
+    parser.add_argument("--rebalance-load", type=float, default=None,
+                        help="Workers above this load move sessions to idle peers "
+                             "(0 = off; default and maximum: --scale-up-load)")
+    parser.add_argument("--interval", type=float, default=2.0, help="Seconds between health polls")
+    parser.add_argument("--up-ticks", type=int, default=2, help="Overloaded polls in a row before scaling up")
+    parser.add_argument("--down-ticks", type=int, default=15, help="Idle polls in a row before scaling down")
+    parser.add_argument("--cooldown", type=float, default=10.0, help="Seconds between scaling actions")
+    parser.add_argument("--drain-timeout", type=float, default=30.0,
+                        help="Terminate a draining worker after this many seconds")
+    args = parser.parse_args(argv)
+
+    if not 1 <= args.min_workers <= args.max_workers:
+        parser.error("need 1 <= --min-workers <= --max-workers")
+    if args.rebalance_load is None:
+        args.rebalance_load = args.scale_up_load
+    elif args.rebalance_load > args.scale_up_load:
+        parser.error("--rebalance-load may not exceed --scale-up-load")
+    Supervisor(args, worker_args).run()
+
+
+if __name__ == "__main__":
+    main()
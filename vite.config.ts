@@ -1,7 +1,7 @@
 import { defineConfig } from 'vite';
 import react from '@vitejs/plugin-react';
 import { resolve } from 'path';
-import { copyFileSync, existsSync, mkdirSync } from 'fs';
+import { copyFileSync, existsSync, mkdirSync, readdirSync } from 'fs';
 
 // Plugin to copy overlay.html to dist root
 const copyOverlayPlugin = () => ({
@@ -15,15 +15,52 @@ const copyOverlayPlugin = () => ({
   },
 });
 
+// Plugin to copy the onnxruntime-web runtime (.wasm + loader) to dist/ort
+// for the WASM engine worker
+const copyOrtWasmPlugin = () => ({
+  name: 'copy-ort-wasm',
+  closeBundle() {
+    const srcDir = resolve(__dirname, 'node_modules/onnxruntime-web/dist');
+    const distDir = resolve(__dirname, 'dist/ort');
+    if (!existsSync(srcDir)) {
+      return;
+    }
+    mkdirSync(distDir, { recursive: true });
+    for (const file of readdirSync(srcDir)) {
+      if (/^ort-wasm-simd-threaded\.(wasm|mjs)$/.test(file)) {
+        copyFileSync(resolve(srcDir, file), resolve(distDir, file));
+      }
+    }
+  },
+});
+
 export default defineConfig({
-  plugins: [react(), copyOverlayPlugin()],
+  plugins: [react(), copyOverlayPlugin(), copyOrtWasmPlugin()],
   base: './',
   server: {
     port: 5173,
     strictPort: true,
+    // Cross-origin isolation, so the WASM engine gets SharedArrayBuffer and threads
+    headers: {
+      'Cross-Origin-Opener-Policy': 'same-origin',
+      'Cross-Origin-Embedder-Policy': 'require-corp',
+    },
+  },
+  optimizeDeps: {
+    exclude: ['onnxruntime-web'],
+  },
+  worker: {
+    format: 'es',
   },
   build: {
     outDir: 'dist',
     emptyOutDir: true,
+    rollupOptions: {
+      // Settings UI, and the hidden window that runs the capture pipeline
+      input: {
+        main: resolve(__dirname, 'index.html'),
+        capture: resolve(__dirname, 'capture.html'),
+      },
+    },
   },
 });